@@ -4,8 +4,10 @@
 
 #include "OpenCL.h"
 
+#include <algorithm>
 #include <utility>
 #include <fstream>
+#include <vector>
 
 namespace OpenCL {
 
@@ -17,7 +19,7 @@ namespace OpenCL {
                                                           buffer(buffer) {}
 
     void Argument::freeResources() {
-        if (buffer == nullptr) return; // local memory
+        if (buffer == nullptr) return; // local memory or scalar
 
         checkStatus(clReleaseMemObject(buffer));
         if (auto freeFn = free) {
@@ -64,7 +66,9 @@ namespace OpenCL {
         return App{
             status, device, context, commandQueue,
             nullptr, nullptr,
-            std::map<cl_uint, std::shared_ptr<Argument>>()
+            std::map<cl_uint, std::shared_ptr<Argument>>(),
+            std::map<std::string, cl_program>(),
+            std::map<std::string, cl_kernel>()
         };
     }
 
@@ -96,6 +100,56 @@ namespace OpenCL {
         return arg;
     }
 
+    std::shared_ptr<Argument>
+    addImageArgument(
+        App& app,
+        const std::string& key, cl_uint index, void* pointer, const std::optional<std::function<void(void*)>>& free,
+        size_t width, size_t height, const cl_image_format& format, cl_mem_flags flags, bool writeImage
+    ) {
+        if (app.arguments.count(index)) {
+            printf("Error: Argument %i already present", index);
+            throw std::runtime_error("Argument " + std::to_string(index) + " already present");
+        }
+
+        cl_image_desc desc{};
+        desc.image_type = CL_MEM_OBJECT_IMAGE2D;
+        desc.image_width = width;
+        desc.image_height = height;
+        cl_mem image = clCreateImage(app.context, flags, &format, &desc, nullptr, &app.status);
+        checkStatus(app.status);
+
+        // write data from the input to the image, rows are tightly packed
+        size_t origin[3] = {0, 0, 0};
+        size_t region[3] = {width, height, 1};
+        if (writeImage)
+            checkStatus(clEnqueueWriteImage(
+                app.commandQueue, image,
+                CL_TRUE, origin, region, 0, 0, pointer,
+                0, nullptr, nullptr
+            ));
+
+        auto arg = std::make_shared<Argument>(key, index, pointer, free, 0, flags, writeImage, image);
+        arg->image = true;
+        arg->imageWidth = width;
+        arg->imageHeight = height;
+        app.arguments.insert({index, arg});
+
+        return arg;
+    }
+
+    std::shared_ptr<Argument> addScalarArgument(App& app, const std::string& key, cl_uint index, void* pointer, size_t size) {
+        if (app.arguments.count(index)) {
+            printf("Error: Argument %i already present", index);
+            throw std::runtime_error("Argument " + std::to_string(index) + " already present");
+        }
+
+        auto arg = std::make_shared<Argument>(key, index, pointer, std::nullopt, size, CL_MEM_FLAGS, false, nullptr);
+        arg->scalar = true;
+        app.arguments.insert({index, arg});
+
+        return arg;
+    }
+
     std::shared_ptr<Argument> addLocalArgument(
         App& app,
         const std::string& key,
@@ -129,33 +183,58 @@ namespace OpenCL {
         app.arguments.insert({index, arg});
     }
 
-    void createKernel(App& app, const std::string& filename, const std::string& kernel) {
-        // read the kernel source
-        std::ifstream ifs(filename);
-        if (!ifs.good()) {
-            printf("Error: Could not open kernel with file name %s!\n", filename.c_str());
-            exit(EXIT_FAILURE);
-        }
-
-        std::string programSource((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
-        const char* programSourceArray = programSource.c_str();
-        size_t programSize = programSource.length();
+    void swapArgumentIndices(App& app, const std::shared_ptr<Argument>& first, const std::shared_ptr<Argument>& second) {
+        // copies, the arguments may be references into the map
+        auto firstArg = first;
+        auto secondArg = second;
+        std::swap(firstArg->index, secondArg->index);
+        app.arguments[firstArg->index] = firstArg;
+        app.arguments[secondArg->index] = secondArg;
+    }
 
-        // create the program
-        app.program = clCreateProgramWithSource(app.context, 1, static_cast<const char**>(&programSourceArray),
-                                                &programSize, &app.status);
-        checkStatus(app.status);
+    void createKernel(App& app, const std::string& filename, const std::string& kernel, const std::string& options) {
+        // every set of build options is a separate program variant
+        auto programKey = filename + " " + options;
+        // switching back to an already created kernel only needs its arguments
+        auto kernelKey = programKey + ":" + kernel;
+        if (app.kernels.count(kernelKey)) {
+            app.program = app.programs[programKey];
+            app.kernel = app.kernels[kernelKey];
+            refreshKernelArguments(app);
+            return;
+        }
 
-        // build the program
-        app.status = clBuildProgram(app.program, 1, &app.device, nullptr, nullptr, nullptr);
-        if (app.status != CL_SUCCESS) {
-            printCompilerError(app.program, app.device);
-            exit(EXIT_FAILURE);
+        if (!app.programs.count(programKey)) {
+            // read the kernel source
+            std::ifstream ifs(filename);
+            if (!ifs.good()) {
+                printf("Error: Could not open kernel with file name %s!\n", filename.c_str());
+                exit(EXIT_FAILURE);
+            }
+
+            std::string programSource((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+            const char* programSourceArray = programSource.c_str();
+            size_t programSize = programSource.length();
+
+            // create the program
+            auto program = clCreateProgramWithSource(app.context, 1, static_cast<const char**>(&programSourceArray),
+                                                     &programSize, &app.status);
+            checkStatus(app.status);
+
+            // build the program
+            app.status = clBuildProgram(program, 1, &app.device, options.c_str(), nullptr, nullptr);
+            if (app.status != CL_SUCCESS) {
+                printCompilerError(program, app.device);
+                exit(EXIT_FAILURE);
+            }
+            app.programs.insert({programKey, program});
         }
+        app.program = app.programs[programKey];
 
         // create the given kernel
         app.kernel = clCreateKernel(app.program, kernel.c_str(), &app.status);
         checkStatus(app.status);
+        app.kernels.insert({kernelKey, app.kernel});
 
         // set the kernel arguments
         refreshKernelArguments(app);
@@ -163,9 +242,9 @@ namespace OpenCL {
 
     void refreshKernelArguments(App& app) {
         for (auto& [_, arg]: app.arguments) {
-            // Differentiate between global & local (buffer=nullptr) memory arguments
+            // Differentiate between global, local (buffer=nullptr) memory & scalar arguments
             auto argSize = arg->buffer == nullptr ? arg->size : sizeof(cl_mem);
-            auto argValue = arg->buffer == nullptr ? nullptr : &arg->buffer;
+            const void* argValue = arg->scalar ? arg->pointer : arg->buffer == nullptr ? nullptr : &arg->buffer;
             checkStatus(clSetKernelArg(
                 app.kernel, arg->index, argSize, argValue
             ));
@@ -219,6 +298,113 @@ namespace OpenCL {
         }
     }
 
+    cl_uint preferredVectorWidthChar(App& app) {
+        cl_uint width;
+        checkStatus(clGetDeviceInfo(
+            app.device, CL_DEVICE_PREFERRED_VECTOR_WIDTH_CHAR, sizeof(cl_uint),
+            &width, nullptr
+        ));
+        printf("Device Capabilities: Preferred char vector width: %u\n", width);
+        return width;
+    }
+
+    cl_device_type deviceType(App& app) {
+        cl_device_type type;
+        checkStatus(clGetDeviceInfo(
+            app.device, CL_DEVICE_TYPE, sizeof(cl_device_type),
+            &type, nullptr
+        ));
+        printf("Device Capabilities: Type: %s\n", type & CL_DEVICE_TYPE_CPU ? "CPU" : type & CL_DEVICE_TYPE_GPU ? "GPU" : "Other");
+        return type;
+    }
+
+    std::string deviceName(App& app) {
+        size_t size;
+        checkStatus(clGetDeviceInfo(app.device, CL_DEVICE_NAME, 0, nullptr, &size));
+        std::vector<char> name(size);
+        checkStatus(clGetDeviceInfo(app.device, CL_DEVICE_NAME, size, name.data(), nullptr));
+        // the size includes the null terminator
+        return {name.data()};
+    }
+
+    bool supportsExtension(App& app, const std::string& extension) {
+        size_t size;
+        checkStatus(clGetDeviceInfo(app.device, CL_DEVICE_EXTENSIONS, 0, nullptr, &size));
+        std::vector<char> extensionsString(size);
+        checkStatus(clGetDeviceInfo(app.device, CL_DEVICE_EXTENSIONS, size, extensionsString.data(), nullptr));
+        // extensions are separated by spaces, the size includes the null terminator
+        std::string extensions(extensionsString.data());
+        auto supported = (" " + extensions + " ").find(" " + extension + " ") != std::string::npos;
+        printf("Device Capabilities: %s %s\n", extension.c_str(), supported ? "supported" : "not supported");
+        return supported;
+    }
+
+    cl_uint deviceVersion(App& app) {
+        size_t size;
+        checkStatus(clGetDeviceInfo(app.device, CL_DEVICE_VERSION, 0, nullptr, &size));
+        std::vector<char> versionString(size);
+        checkStatus(clGetDeviceInfo(app.device, CL_DEVICE_VERSION, size, versionString.data(), nullptr));
+        // "OpenCL <major>.<minor> <vendor-specific information>"
+        cl_uint major = 1, minor = 0;
+        sscanf(versionString.data(), "OpenCL %u.%u", &major, &minor);
+        printf("Device Capabilities: OpenCL %u.%u\n", major, minor);
+        return major * 10 + minor;
+    }
+
+    bool supportsOpenCLCFeature(App& app, const std::string& feature) {
+        auto supported = false;
+#ifdef CL_VERSION_3_0
+        // devices before OpenCL 3.0 reject the query
+        size_t size = 0;
+        if (clGetDeviceInfo(app.device, CL_DEVICE_OPENCL_C_FEATURES, 0, nullptr, &size) == CL_SUCCESS) {
+            std::vector<cl_name_version> features(size / sizeof(cl_name_version));
+            checkStatus(clGetDeviceInfo(app.device, CL_DEVICE_OPENCL_C_FEATURES, size, features.data(), nullptr));
+            for (const auto& deviceFeature : features) {
+                if (feature == deviceFeature.name) supported = true;
+            }
+        }
+#endif
+        printf("Device Capabilities: %s %s\n", feature.c_str(), supported ? "supported" : "not supported");
+        return supported;
+    }
+
+    bool supportsImageFormat(App& app, const cl_image_format& format, cl_mem_flags flags, size_t width, size_t height) {
+        cl_bool imageSupport;
+        checkStatus(clGetDeviceInfo(
+            app.device, CL_DEVICE_IMAGE_SUPPORT, sizeof(cl_bool),
+            &imageSupport, nullptr
+        ));
+        size_t maxWidth = 0;
+        size_t maxHeight = 0;
+        std::vector<cl_image_format> formats;
+        if (imageSupport) {
+            checkStatus(clGetDeviceInfo(
+                app.device, CL_DEVICE_IMAGE2D_MAX_WIDTH, sizeof(size_t),
+                &maxWidth, nullptr
+            ));
+            checkStatus(clGetDeviceInfo(
+                app.device, CL_DEVICE_IMAGE2D_MAX_HEIGHT, sizeof(size_t),
+                &maxHeight, nullptr
+            ));
+            cl_uint numFormats;
+            checkStatus(clGetSupportedImageFormats(
+                app.context, flags, CL_MEM_OBJECT_IMAGE2D, 0, nullptr, &numFormats
+            ));
+            formats.resize(numFormats);
+            checkStatus(clGetSupportedImageFormats(
+                app.context, flags, CL_MEM_OBJECT_IMAGE2D, numFormats, formats.data(), nullptr
+            ));
+        }
+        auto formatSupported = std::any_of(formats.begin(), formats.end(), [&](const cl_image_format& supported) {
+            return supported.image_channel_order == format.image_channel_order &&
+                   supported.image_channel_data_type == format.image_channel_data_type;
+        });
+        auto supported = formatSupported && width <= maxWidth && height <= maxHeight;
+        printf("Device Capabilities: Image objects of %zux%zu pixels in this format %s\n",
+               width, height, supported ? "supported" : "not supported");
+        return supported;
+    }
+
     void enqueueKernel(App& app, cl_uint workDimensions, size_t* globalWorkSize, size_t* localWorkSize,
                        cl_uint num_events_in_wait_list, cl_event* event_wait, cl_event* event) {
         // execute the kernel
@@ -236,6 +422,16 @@ namespace OpenCL {
     }
 
     void readBuffer(App& app, const std::shared_ptr<Argument>& arg, cl_bool blockingRead) {
+        if (arg->image) {
+            // image objects are read by region into tightly packed rows
+            size_t origin[3] = {0, 0, 0};
+            size_t region[3] = {arg->imageWidth, arg->imageHeight, 1};
+            checkStatus(clEnqueueReadImage(
+                app.commandQueue, arg->buffer, blockingRead,
+                origin, region, 0, 0, arg->pointer, 0, nullptr, nullptr
+            ));
+            return;
+        }
         // read the device output buffer to the host output array
         // `clEnqueueReadBuffer` does not wait for the kernel unless `blocking_read` is set to `CL_TRUE`
         checkStatus(clEnqueueReadBuffer(
@@ -244,10 +440,73 @@ namespace OpenCL {
         ));
     }
 
+    void readBuffer(App& app, const std::shared_ptr<Argument>& arg, void* pointer, size_t size, cl_bool blockingRead) {
+        if (arg->image) {
+            size_t origin[3] = {0, 0, 0};
+            size_t region[3] = {arg->imageWidth, arg->imageHeight, 1};
+            checkStatus(clEnqueueReadImage(
+                app.commandQueue, arg->buffer, blockingRead,
+                origin, region, 0, 0, pointer, 0, nullptr, nullptr
+            ));
+            return;
+        }
+        checkStatus(clEnqueueReadBuffer(
+            app.commandQueue, arg->buffer, blockingRead,
+            0, size, pointer, 0, nullptr, nullptr
+        ));
+    }
+
+    void writeBuffer(App& app, const std::shared_ptr<Argument>& arg, cl_bool blockingWrite) {
+        if (arg->image) {
+            size_t origin[3] = {0, 0, 0};
+            size_t region[3] = {arg->imageWidth, arg->imageHeight, 1};
+            checkStatus(clEnqueueWriteImage(
+                app.commandQueue, arg->buffer, blockingWrite,
+                origin, region, 0, 0, arg->pointer, 0, nullptr, nullptr
+            ));
+            return;
+        }
+        checkStatus(clEnqueueWriteBuffer(
+            app.commandQueue, arg->buffer, blockingWrite,
+            0, arg->size, arg->pointer, 0, nullptr, nullptr
+        ));
+    }
+
+    void finish(App& app) {
+        checkStatus(clFinish(app.commandQueue));
+    }
+
+    void writeBufferRect(
+        App& app, const std::shared_ptr<Argument>& arg, const size_t* bufferOrigin, const size_t* hostOrigin,
+        const size_t* region, size_t bufferRowPitch, size_t hostRowPitch, const void* pointer
+    ) {
+        // origins and the region are in bytes along a row, in rows and in slices
+        checkStatus(clEnqueueWriteBufferRect(
+            app.commandQueue, arg->buffer, CL_TRUE,
+            bufferOrigin, hostOrigin, region, bufferRowPitch, 0, hostRowPitch, 0, pointer,
+            0, nullptr, nullptr
+        ));
+    }
+
+    void readBufferRect(
+        App& app, const std::shared_ptr<Argument>& arg, const size_t* bufferOrigin, const size_t* hostOrigin,
+        const size_t* region, size_t bufferRowPitch, size_t hostRowPitch, void* pointer, cl_bool blockingRead
+    ) {
+        checkStatus(clEnqueueReadBufferRect(
+            app.commandQueue, arg->buffer, blockingRead,
+            bufferOrigin, hostOrigin, region, bufferRowPitch, 0, hostRowPitch, 0, pointer,
+            0, nullptr, nullptr
+        ));
+    }
+
     void release(App& app) {
         // release allocated resources
-        checkStatus(clReleaseKernel(app.kernel));
-        checkStatus(clReleaseProgram(app.program));
+        for (auto& [_, kernel]: app.kernels) {
+            checkStatus(clReleaseKernel(kernel));
+        }
+        for (auto& [_, program]: app.programs) {
+            checkStatus(clReleaseProgram(program));
+        }
 
         for (auto& [_, arg]: app.arguments) {
             arg->freeResources();
@@ -40,6 +40,12 @@ namespace OpenCL {
 
         bool writeBuffer;
         cl_mem buffer;
+        // 2D image objects are transferred by region, their size is in pixels
+        bool image = false;
+        size_t imageWidth = 0;
+        size_t imageHeight = 0;
+        // Scalars are passed by value, the pointed-to value is read whenever the kernel arguments are set
+        bool scalar = false;
 
         Argument(std::string  key, cl_uint index, void* pointer,
                  const std::optional<std::function<void(void*)>>& free, size_t size, cl_mem_flags flags,
@@ -56,6 +62,9 @@ namespace OpenCL {
         cl_program program;
         cl_kernel kernel;
         std::map<cl_uint, std::shared_ptr<Argument>> arguments;
+        // Built programs by file name & build options, created kernels additionally by kernel name
+        std::map<std::string, cl_program> programs;
+        std::map<std::string, cl_kernel> kernels;
     };
 
     App setup();
@@ -71,6 +80,27 @@ namespace OpenCL {
         bool writeBuffer
     );
 
+    std::shared_ptr<Argument> addImageArgument(
+        App& app,
+        const std::string& key,
+        cl_uint index,
+        void* pointer,
+        const std::optional<std::function<void(void*)>>& free,
+        size_t width,
+        size_t height,
+        const cl_image_format& format,
+        cl_mem_flags flags,
+        bool writeImage
+    );
+
+    std::shared_ptr<Argument> addScalarArgument(
+        App& app,
+        const std::string& key,
+        cl_uint index,
+        void* pointer,
+        size_t size
+    );
+
     std::shared_ptr<Argument> addLocalArgument(
         App& app,
         const std::string& key,
@@ -82,10 +112,13 @@ namespace OpenCL {
 
     void changeArgumentIndex(App& app, const std::shared_ptr<Argument>& arg, cl_uint index);
 
+    void swapArgumentIndices(App& app, const std::shared_ptr<Argument>& first, const std::shared_ptr<Argument>& second);
+
     void createKernel(
         App& app,
         const std::string& filename,
-        const std::string& kernel
+        const std::string& kernel,
+        const std::string& options = ""
     );
 
     void refreshKernelArguments(App& app);
@@ -100,6 +133,22 @@ namespace OpenCL {
         )>& check
     );
 
+    cl_uint preferredVectorWidthChar(App& app);
+
+    cl_device_type deviceType(App& app);
+
+    std::string deviceName(App& app);
+
+    bool supportsExtension(App& app, const std::string& extension);
+
+    // OpenCL version of the device as major * 10 + minor, e.g. 21 for OpenCL 2.1
+    cl_uint deviceVersion(App& app);
+
+    // Optional OpenCL C 3.0 feature of the device, e.g. __opencl_c_subgroups, false before OpenCL 3.0
+    bool supportsOpenCLCFeature(App& app, const std::string& feature);
+
+    bool supportsImageFormat(App& app, const cl_image_format& format, cl_mem_flags flags, size_t width, size_t height);
+
     void enqueueKernel(
         App& app,
         cl_uint workDimensions,
@@ -118,6 +167,48 @@ namespace OpenCL {
         cl_bool blockingRead
     );
 
+    // Reads the first size bytes of a buffer, or a whole image, into pointer instead of the host array of the argument
+    void readBuffer(
+        App& app,
+        const std::shared_ptr<Argument>& arg,
+        void* pointer,
+        size_t size,
+        cl_bool blockingRead
+    );
+
+    // Writes the host array of the argument to its buffer or image again
+    void writeBuffer(
+        App& app,
+        const std::shared_ptr<Argument>& arg,
+        cl_bool blockingWrite
+    );
+
+    // Waits until all enqueued commands have finished
+    void finish(App& app);
+
+    void writeBufferRect(
+        App& app,
+        const std::shared_ptr<Argument>& arg,
+        const size_t* bufferOrigin,
+        const size_t* hostOrigin,
+        const size_t* region,
+        size_t bufferRowPitch,
+        size_t hostRowPitch,
+        const void* pointer
+    );
+
+    void readBufferRect(
+        App& app,
+        const std::shared_ptr<Argument>& arg,
+        const size_t* bufferOrigin,
+        const size_t* hostOrigin,
+        const size_t* region,
+        size_t bufferRowPitch,
+        size_t hostRowPitch,
+        void* pointer,
+        cl_bool blockingRead
+    );
+
     void release(App& app);
 
 
@@ -1,5 +1,11 @@
 
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <filesystem>
+#include <fstream>
 #include <string>
 #include <sstream>
 
@@ -13,44 +19,240 @@
 #include "OpenCL.h"
 
 
+// Component type of the pixels, 16-bit PNGs and HDR images keep their precision
+enum class PixelType {
+    UChar,
+    UShort,
+    Float
+};
+
 struct Image {
     cl_int width;
     cl_int height;
     cl_int channels;
+    PixelType type;
+    size_t pixelSize;
     size_t size;
-    cl_uchar* data;
+    void* data;
 };
 
 Image loadImage(const std::string& filename) {
     int width, height, channels;
-    cl_uchar* data = stbi_load(
-        filename.c_str(),
-        &width, &height, &channels, 0
-    );
+    PixelType type;
+    size_t componentSize;
+    void* data;
+    if (stbi_is_hdr(filename.c_str())) {
+        type = PixelType::Float;
+        componentSize = sizeof(cl_float);
+        data = stbi_loadf(filename.c_str(), &width, &height, &channels, 0);
+    } else if (stbi_is_16_bit(filename.c_str())) {
+        type = PixelType::UShort;
+        componentSize = sizeof(cl_ushort);
+        data = stbi_load_16(filename.c_str(), &width, &height, &channels, 0);
+    } else {
+        type = PixelType::UChar;
+        componentSize = sizeof(cl_uchar);
+        data = stbi_load(filename.c_str(), &width, &height, &channels, 0);
+    }
     if (data == nullptr) {
         printf("Error in loading the image\n");
         exit(1);
     }
-    if (channels != 3) {
-        printf("Unsupported channel size %i, only 3 is supported\n", channels);
+    // grayscale, grayscale & alpha, RGB and RGBA
+    if (channels < 1 || channels > 4) {
+        printf("Unsupported channel size %i, only 1 to 4 are supported\n", channels);
         exit(1);
     }
     printf(
-        "Loaded image with a width of %dpx, a height of %dpx and %d channels\n",
-        width, height, channels
+        "Loaded image with a width of %dpx, a height of %dpx and %d channels of %zu bit\n",
+        width, height, channels, 8 * componentSize
     );
 
-    size_t size = width * height * channels * sizeof(cl_uchar);
+    size_t pixelSize = channels * componentSize;
+    size_t size = width * height * pixelSize;
 
     return Image{
-        width, height, channels, size, data
+        width, height, channels, type, pixelSize, size, data
     };
 }
 
+// stb_image_write only writes 8-bit PNGs, 16-bit images are written as unfiltered big endian scanlines
+// compressed with the zlib implementation of stb_image_write
+bool writePng16(const std::string& filename, int width, int height, int channels, const cl_ushort* data) {
+    std::vector<unsigned char> scanlines;
+    scanlines.reserve(height * (1 + 2 * width * channels));
+    for (int y = 0; y < height; ++y) {
+        scanlines.push_back(0);
+        for (int i = 0; i < width * channels; ++i) {
+            auto component = data[y * width * channels + i];
+            scanlines.push_back(component >> 8);
+            scanlines.push_back(component & 0xFF);
+        }
+    }
+    int compressedSize;
+    auto* compressed = stbi_zlib_compress(scanlines.data(), (int) scanlines.size(), &compressedSize, 8);
+    if (compressed == nullptr) return false;
+
+    auto* file = fopen(filename.c_str(), "wb");
+    if (file == nullptr) {
+        free(compressed);
+        return false;
+    }
+    auto writeUInt32 = [&](uint32_t value) {
+        unsigned char bytes[4] = {
+            static_cast<unsigned char>(value >> 24), static_cast<unsigned char>(value >> 16),
+            static_cast<unsigned char>(value >> 8), static_cast<unsigned char>(value)
+        };
+        fwrite(bytes, 1, 4, file);
+    };
+    auto writeChunk = [&](const char* type, const unsigned char* chunk, size_t size) {
+        // CRC-32 over chunk type and data
+        uint32_t crc = 0xFFFFFFFF;
+        auto update = [&](unsigned char byte) {
+            crc ^= byte;
+            for (int bit = 0; bit < 8; ++bit) crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+        };
+        for (int i = 0; i < 4; ++i) update(type[i]);
+        for (size_t i = 0; i < size; ++i) update(chunk[i]);
+        writeUInt32(size);
+        fwrite(type, 1, 4, file);
+        fwrite(chunk, 1, size, file);
+        writeUInt32(crc ^ 0xFFFFFFFF);
+    };
+
+    // gray, gray & alpha, RGB, RGBA
+    const unsigned char colorTypes[] = {0, 4, 2, 6};
+    unsigned char header[13] = {
+        static_cast<unsigned char>(width >> 24), static_cast<unsigned char>(width >> 16),
+        static_cast<unsigned char>(width >> 8), static_cast<unsigned char>(width),
+        static_cast<unsigned char>(height >> 24), static_cast<unsigned char>(height >> 16),
+        static_cast<unsigned char>(height >> 8), static_cast<unsigned char>(height),
+        16, colorTypes[channels - 1], 0, 0, 0
+    };
+    const unsigned char signature[] = {137, 80, 78, 71, 13, 10, 26, 10};
+    fwrite(signature, 1, sizeof(signature), file);
+    writeChunk("IHDR", header, sizeof(header));
+    writeChunk("IDAT", compressed, compressedSize);
+    writeChunk("IEND", nullptr, 0);
+    free(compressed);
+    return fclose(file) == 0;
+}
+
+// Output in the precision of the input, returns the file name, nothing if the image could not be written
+std::optional<std::string> writeImage(const Image& image, void* data, const std::string& name = "blurred") {
+    std::string filename = name + (image.type == PixelType::Float ? ".hdr" : ".png");
+    bool written;
+    if (image.type == PixelType::Float) {
+        written = stbi_write_hdr(
+            filename.c_str(), image.width, image.height, image.channels, static_cast<cl_float*>(data)
+        ) != 0;
+    } else if (image.type == PixelType::UShort) {
+        written = writePng16(filename, image.width, image.height, image.channels, static_cast<cl_ushort*>(data));
+    } else {
+        written = stbi_write_png(
+            filename.c_str(), image.width, image.height, image.channels, data, image.width * image.channels
+        ) != 0;
+    }
+    if (!written) {
+        printf("Error: Could not write image %s\n", filename.c_str());
+        return std::nullopt;
+    }
+    return filename;
+}
+
+// Image paths of a batch, one per line
+std::vector<std::string> readBatchList(const std::string& listFilename) {
+    std::ifstream list(listFilename);
+    if (!list.good()) {
+        printf("Error: Could not open batch list %s\n", listFilename.c_str());
+        exit(EXIT_FAILURE);
+    }
+    std::vector<std::string> filenames;
+    std::string line;
+    while (std::getline(list, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (!line.empty()) filenames.push_back(line);
+    }
+    if (filenames.empty()) {
+        printf("Error: The batch list %s is empty\n", listFilename.c_str());
+        exit(EXIT_FAILURE);
+    }
+    return filenames;
+}
+
+// Loads the images of a batch back to back into a single allocation,
+// all of them need the size, channels & pixel type of the first
+Image loadBatch(const std::vector<std::string>& filenames) {
+    auto first = loadImage(filenames[0]);
+    auto* data = static_cast<char*>(malloc(first.size * filenames.size()));
+    memcpy(data, first.data, first.size);
+    stbi_image_free(first.data);
+    for (size_t i = 1; i < filenames.size(); ++i) {
+        auto image = loadImage(filenames[i]);
+        if (image.width != first.width || image.height != first.height ||
+            image.channels != first.channels || image.type != first.type) {
+            printf("Error: %s differs from the first image of the batch in size, channels or bit depth\n",
+                   filenames[i].c_str());
+            exit(EXIT_FAILURE);
+        }
+        memcpy(data + i * first.size, image.data, first.size);
+        stbi_image_free(image.data);
+    }
+    first.data = data;
+    return first;
+}
+
+// Faster variant of the benchmark per device, one "<image|buffers> <device name>" line per device.
+// The records are kept in the configuration directory of the user, independent of the working directory.
+std::filesystem::path benchmarkRecords() {
+#if _WIN32
+    const char* appData = getenv("APPDATA");
+    std::filesystem::path directory = appData != nullptr ? appData : ".";
+#else
+    const char* configHome = getenv("XDG_CONFIG_HOME");
+    const char* home = getenv("HOME");
+    std::filesystem::path directory = configHome != nullptr && *configHome ? std::filesystem::path(configHome) :
+                                      home != nullptr ? std::filesystem::path(home) / ".config" : ".";
+#endif
+    return directory / "gaussian-blur" / "benchmarks.txt";
+}
+
+// Variant recorded as faster for the device, empty if it was never benchmarked
+std::string recordedBenchmark(const std::string& device) {
+    std::ifstream records(benchmarkRecords());
+    std::string line;
+    while (std::getline(records, line)) {
+        auto separator = line.find(' ');
+        if (separator != std::string::npos && line.substr(separator + 1) == device) return line.substr(0, separator);
+    }
+    return "";
+}
+
+// Replaces the record of the device, the records of other devices are kept
+void recordBenchmark(const std::string& device, const std::string& faster) {
+    std::vector<std::string> lines;
+    {
+        std::ifstream records(benchmarkRecords());
+        std::string line;
+        while (std::getline(records, line)) {
+            auto separator = line.find(' ');
+            if (separator == std::string::npos || line.substr(separator + 1) != device) lines.push_back(line);
+        }
+    }
+    lines.push_back(faster + " " + device);
+    std::error_code error;
+    std::filesystem::create_directories(benchmarkRecords().parent_path(), error);
+    std::ofstream records(benchmarkRecords());
+    for (auto& line: lines) records << line << '\n';
+    if (!records.good()) printf("Benchmark: could not write %s\n", benchmarkRecords().string().c_str());
+}
+
 struct SmoothKernel {
     cl_int dimension;
     size_t size;
     cl_float* data;
+    // Mirrored weights are equal, the kernels may fold the convolution
+    bool symmetric;
 };
 
 void removeChar(std::string& str, char c) {
@@ -74,6 +276,60 @@ cl_float* strToFloat(std::vector<std::string>& strings) {
     return values;
 }
 
+// Sampled Gaussian with a radius of 3 sigma, normalized to a sum of 1
+SmoothKernel gaussianSmoothKernel(float sigma) {
+    auto radius = static_cast<int>(std::ceil(3 * sigma));
+    auto dimension = 2 * radius + 1;
+    auto* data = static_cast<cl_float*>(malloc(sizeof(cl_float) * dimension));
+    double sum = 0;
+    for (int i = 0; i < dimension; ++i) {
+        data[i] = std::exp(-0.5f * (i - radius) * (i - radius) / (sigma * sigma));
+        sum += data[i];
+    }
+    for (int i = 0; i < dimension; ++i) {
+        data[i] = static_cast<cl_float>(data[i] / sum);
+    }
+    return SmoothKernel{dimension, dimension * sizeof(cl_float), data, true};
+}
+
+// Gaussians of two sigmas sampled with the radius of the wider one, back to back in one kernel of the dog mode.
+// The pair is convolved without folding.
+SmoothKernel differenceOfGaussiansKernel(float firstSigma, float secondSigma) {
+    auto first = gaussianSmoothKernel(firstSigma);
+    auto second = gaussianSmoothKernel(secondSigma);
+    auto dimension = std::max(first.dimension, second.dimension);
+    auto* data = static_cast<cl_float*>(calloc(2 * dimension, sizeof(cl_float)));
+    memcpy(data + (dimension - first.dimension) / 2, first.data, first.size);
+    memcpy(data + dimension + (dimension - second.dimension) / 2, second.data, second.size);
+    free(first.data);
+    free(second.data);
+    return SmoothKernel{dimension, 2 * dimension * sizeof(cl_float), data, false};
+}
+
+// Gaussian and its second derivative scaled by sigma² back to back in one kernel of the log mode, with a radius of
+// 4 sigma as the tails of the derivative are wider. The derivative sums up to 0, so flat areas stay 0.
+SmoothKernel laplacianOfGaussianKernel(float sigma) {
+    auto radius = static_cast<int>(std::ceil(4 * sigma));
+    auto dimension = 2 * radius + 1;
+    auto* data = static_cast<cl_float*>(malloc(2 * dimension * sizeof(cl_float)));
+    double sum = 0;
+    for (int i = 0; i < dimension; ++i) {
+        data[i] = std::exp(-0.5f * (i - radius) * (i - radius) / (sigma * sigma));
+        sum += data[i];
+    }
+    double derivativeSum = 0;
+    for (int i = 0; i < dimension; ++i) {
+        data[i] = static_cast<cl_float>(data[i] / sum);
+        auto x = static_cast<float>(i - radius);
+        data[dimension + i] = data[i] * (x * x - sigma * sigma) / (sigma * sigma);
+        derivativeSum += data[dimension + i];
+    }
+    for (int i = 0; i < dimension; ++i) {
+        data[dimension + i] -= static_cast<cl_float>(data[i] * derivativeSum);
+    }
+    return SmoothKernel{dimension, 2 * dimension * sizeof(cl_float), data, false};
+}
+
 SmoothKernel loadSmoothKernel(const std::string& kernelInput) {
     auto kernelRaw = kernelInput;
     removeChar(kernelRaw, '(');
@@ -84,46 +340,1082 @@ SmoothKernel loadSmoothKernel(const std::string& kernelInput) {
     if (dimension % 2 != 0) {
         auto data = strToFloat(kernelSplit);
         auto size = dimension * sizeof(cl_float);
-        return SmoothKernel{static_cast<cl_int>((cl_uint) dimension), size, data};
+        auto symmetric = true;
+        for (size_t i = 0; i < dimension / 2; ++i) {
+            if (data[i] != data[dimension - 1 - i]) symmetric = false;
+        }
+        return SmoothKernel{static_cast<cl_int>((cl_uint) dimension), size, data, symmetric};
     } else {
         printf("Unsupported kernel size: %zu\n", dimension);
         exit(1);
     }
 }
 
-int main(int argc, char** argv) {
-    printf("gaussian-blur\n");
-    std::vector<std::string> args(&argv[0], &argv[0 + argc]);
-    args.erase(args.begin());
+enum class BlurMode {
+    Auto,
+    Row,
+    Tiled,
+    Transposed,
+    Fused,
+    Blocked,
+    Gray,
+    Recursive,
+    Box,
+    Pyramid,
+    Image,
+    Subgroup,
+    Dog,
+    Log
+};
+
+enum class Precision {
+    Auto,
+    Float,
+    Fixed,
+    Half
+};
+
+// Continuation of the image beyond its edges for the taps of the convolution
+enum class BorderMode {
+    Clamp,
+    Mirror,
+    Wrap,
+    Constant
+};
+
+// Rectangle of an image in pixels
+struct Region {
+    size_t x;
+    size_t y;
+    size_t width;
+    size_t height;
+};
 
-    auto argsCount = args.size();
+struct Options {
     std::string filename;
     std::string kernelInput;
+    BlurMode mode;
+    // Work-group size of the tiled mode, shrunk to the device limits if necessary
+    size_t tileWidth;
+    size_t tileHeight;
+    // Pixels per work-item of the blocked mode, 0 uses the preferred vector width of the device
+    size_t blockSize;
+    // Bake radius, weights & direction into the kernels instead of reading them at runtime
+    bool specialize;
+    // Arithmetic of the convolution, auto uses fixed point on CPU devices and half for small kernels if available
+    Precision precision;
+    // Standard deviation of a Gaussian given instead of a kernel, 0 if a kernel is given
+    float sigma;
+    // Time the image object kernel against the buffer kernels of the mode, keep the faster output and record the
+    // faster variant for the device, which the auto mode picks from then on
+    bool benchmark;
+    BorderMode border;
+    // Text file listing the same-sized images of a batch instead of a single filename, empty if not batched
+    std::string batchList;
+    // Regions of interest, the only pixels that are blurred, the whole image if empty
+    std::vector<Region> rois;
+    // Amount of an unsharp mask applied by the last pass, 0 only blurs
+    float sharpenAmount;
+    // Smallest difference between original and blurred pixel that is sharpened, in levels of the pixel format
+    float sharpenThreshold;
+    // Blur 8-bit sRGB images in linear light instead of blurring the gamma encoded values
+    bool linearLight;
+    // Blur the colors of straight alpha images weighted by their alpha, so transparent pixels do not bleed
+    bool premultipliedAlpha;
+    // Ascending standard deviations of a scale space blurred from one upload of the input, empty for a single blur
+    std::vector<float> scales;
+};
+
+// Standard deviations of a scale space separated by commas, at least two in strictly ascending order
+bool parseScales(std::string& list, std::vector<float>& scales) {
+    scales.clear();
+    for (auto& value: splitStr(list, ',')) {
+        char* end;
+        auto sigma = std::strtof(value.c_str(), &end);
+        if (end == value.c_str() || *end != '\0' || sigma <= (scales.empty() ? 0 : scales.back())) return false;
+        scales.push_back(sigma);
+    }
+    return scales.size() > 1;
+}
+
+void printUsage() {
+    printf("Usage [filename] [optional: kernel] [optional: --mode=auto|row|tiled|transposed|fused|blocked|gray|recursive|box|pyramid|image|subgroup|dog|log] [optional: --sigma=<sigma>] [optional: --tile=<width>x<height>] [optional: --block=<pixels>] [optional: --generic] [optional: --precision=auto|float|fixed|half] [optional: --benchmark] [optional: --border=clamp|mirror|wrap|constant] [optional: --batch=<list>] [optional, repeatable: --roi=<x>,<y>,<width>x<height>] [optional: --sharpen=<amount>] [optional: --threshold=<levels>] [optional: --linear] [optional: --premultiply] [optional: --scales=<sigma>,<sigma>,...]\n");
+}
+
+Options parseOptions(const std::vector<std::string>& args) {
+    Options options{
+        "",
+        "(0.000134,0.004432,0.053991,"
+        "0.241971,0.398943,0.241971,"
+        "0.053991,0.004432,0.000134)",
+        BlurMode::Auto,
+        16, 16,
+        0,
+        true,
+        Precision::Auto,
+        0,
+        false,
+        BorderMode::Clamp,
+        "",
+        {},
+        0,
+        0,
+        false,
+        false,
+        {}
+    };
 
-    if (argsCount == 1) {
-        filename = args[0];
-        kernelInput = "(0.000134,0.004432,0.053991,"
-                      "0.241971,0.398943,0.241971,"
-                      "0.053991,0.004432,0.000134)";
-    } else if (argsCount == 2) {
-        filename = args[0];
-        kernelInput = args[1];
+    std::vector<std::string> positional;
+    for (auto& arg: args) {
+        if (arg.rfind("--", 0) != 0) {
+            positional.push_back(arg);
+            continue;
+        }
+        auto separator = arg.find('=');
+        auto key = arg.substr(2, separator == std::string::npos ? std::string::npos : separator - 2);
+        auto value = separator == std::string::npos ? "" : arg.substr(separator + 1);
+        Region roi{};
+        if (key == "mode" && value == "auto") {
+            options.mode = BlurMode::Auto;
+        } else if (key == "mode" && value == "row") {
+            options.mode = BlurMode::Row;
+        } else if (key == "mode" && value == "tiled") {
+            options.mode = BlurMode::Tiled;
+        } else if (key == "mode" && value == "transposed") {
+            options.mode = BlurMode::Transposed;
+        } else if (key == "mode" && value == "fused") {
+            options.mode = BlurMode::Fused;
+        } else if (key == "mode" && value == "blocked") {
+            options.mode = BlurMode::Blocked;
+        } else if (key == "mode" && value == "gray") {
+            options.mode = BlurMode::Gray;
+        } else if (key == "mode" && value == "recursive") {
+            options.mode = BlurMode::Recursive;
+        } else if (key == "mode" && value == "box") {
+            options.mode = BlurMode::Box;
+        } else if (key == "mode" && value == "pyramid") {
+            options.mode = BlurMode::Pyramid;
+        } else if (key == "mode" && value == "image") {
+            options.mode = BlurMode::Image;
+        } else if (key == "mode" && value == "subgroup") {
+            options.mode = BlurMode::Subgroup;
+        } else if (key == "mode" && value == "dog") {
+            options.mode = BlurMode::Dog;
+        } else if (key == "mode" && value == "log") {
+            options.mode = BlurMode::Log;
+        } else if (key == "sigma" && sscanf(value.c_str(), "%f", &options.sigma) == 1 && options.sigma > 0) {
+            continue;
+        } else if (key == "tile" &&
+                   sscanf(value.c_str(), "%zux%zu", &options.tileWidth, &options.tileHeight) == 2 &&
+                   options.tileWidth > 0 && options.tileHeight > 0) {
+            continue;
+        } else if (key == "block" && sscanf(value.c_str(), "%zu", &options.blockSize) == 1 && options.blockSize > 0) {
+            continue;
+        } else if (key == "generic" && value.empty()) {
+            options.specialize = false;
+        } else if (key == "linear" && value.empty()) {
+            options.linearLight = true;
+        } else if (key == "premultiply" && value.empty()) {
+            options.premultipliedAlpha = true;
+        } else if (key == "benchmark" && value.empty()) {
+            options.benchmark = true;
+        } else if (key == "border" && value == "clamp") {
+            options.border = BorderMode::Clamp;
+        } else if (key == "border" && value == "mirror") {
+            options.border = BorderMode::Mirror;
+        } else if (key == "border" && value == "wrap") {
+            options.border = BorderMode::Wrap;
+        } else if (key == "border" && value == "constant") {
+            options.border = BorderMode::Constant;
+        } else if (key == "roi" &&
+                   sscanf(value.c_str(), "%zu,%zu,%zux%zu", &roi.x, &roi.y, &roi.width, &roi.height) == 4 &&
+                   roi.width > 0 && roi.height > 0) {
+            options.rois.push_back(roi);
+        } else if (key == "sharpen" &&
+                   sscanf(value.c_str(), "%f", &options.sharpenAmount) == 1 && options.sharpenAmount > 0) {
+            continue;
+        } else if (key == "threshold" &&
+                   sscanf(value.c_str(), "%f", &options.sharpenThreshold) == 1 && options.sharpenThreshold >= 0) {
+            continue;
+        } else if (key == "scales" && parseScales(value, options.scales)) {
+            continue;
+        } else if (key == "batch" && !value.empty()) {
+            options.batchList = value;
+        } else if (key == "precision" && value == "auto") {
+            options.precision = Precision::Auto;
+        } else if (key == "precision" && value == "float") {
+            options.precision = Precision::Float;
+        } else if (key == "precision" && value == "fixed") {
+            options.precision = Precision::Fixed;
+        } else if (key == "precision" && value == "half") {
+            options.precision = Precision::Half;
+        } else {
+            printf("Invalid option %s\n", arg.c_str());
+            printUsage();
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // the first level of a scale space is blurred like a single Gaussian
+    if (!options.scales.empty() && options.sigma > 0) {
+        printf("Invalid input\n");
+        printUsage();
+        exit(EXIT_FAILURE);
+    } else if (!options.scales.empty()) {
+        options.sigma = options.scales.front();
+    }
+
+    // a batch list replaces the filename
+    if (!options.batchList.empty() && positional.empty()) {
+        return options;
+    } else if (!options.batchList.empty() && positional.size() == 1 && options.sigma == 0) {
+        options.kernelInput = positional[0];
+    } else if (!options.batchList.empty()) {
+        printf("Invalid input\n");
+        printUsage();
+        exit(EXIT_FAILURE);
+    } else if (positional.size() == 1) {
+        options.filename = positional[0];
+    } else if (positional.size() == 2 && options.sigma == 0) {
+        options.filename = positional[0];
+        options.kernelInput = positional[1];
     } else {
         printf("Invalid input\n");
-        printf("Usage [filename] [optional: kernel]\n");
+        printUsage();
         exit(EXIT_FAILURE);
     }
 
+    return options;
+}
+
+struct BlurPass {
+    size_t globalWorkSize[2];
+    size_t localWorkSize[2];
+    size_t cacheSize;
+};
+
+// One work-group caches a whole row (horizontal) or column (vertical)
+BlurPass rowPass(bool horizontal, size_t width, size_t height, size_t pixelSize) {
+    return BlurPass{
+        {width, height}, // https://stackoverflow.com/a/31379085
+        {horizontal ? width : 1, horizontal ? 1 : height},
+        (horizontal ? width : height) * pixelSize
+    };
+}
+
+size_t tileCacheSize(bool horizontal, size_t tileWidth, size_t tileHeight, size_t radius, size_t pixelSize) {
+    auto cacheWidth = tileWidth + (horizontal ? 2 * radius : 0);
+    auto cacheHeight = tileHeight + (horizontal ? 0 : 2 * radius);
+    return cacheWidth * cacheHeight * pixelSize;
+}
+
+// One work-group caches a tile plus a radius sized halo along the blur direction,
+// the global work size is rounded up to whole tiles
+BlurPass tiledPass(bool horizontal, size_t width, size_t height, size_t pixelSize,
+                   size_t tileWidth, size_t tileHeight, size_t radius) {
+    return BlurPass{
+        {(width + tileWidth - 1) / tileWidth * tileWidth, (height + tileHeight - 1) / tileHeight * tileHeight},
+        {tileWidth, tileHeight},
+        tileCacheSize(horizontal, tileWidth, tileHeight, radius, pixelSize)
+    };
+}
+
+// Vertical pass only, columns of the tile plus halo are cached transposed with an odd pitch
+size_t transposedCacheSize(size_t tileWidth, size_t tileHeight, size_t radius, size_t pixelSize) {
+    auto cachePitch = (tileHeight + 2 * radius) | 1;
+    return tileWidth * cachePitch * pixelSize;
+}
+
+BlurPass transposedPass(size_t width, size_t height, size_t pixelSize,
+                        size_t tileWidth, size_t tileHeight, size_t radius) {
+    auto pass = tiledPass(false, width, height, pixelSize, tileWidth, tileHeight, radius);
+    pass.cacheSize = transposedCacheSize(tileWidth, tileHeight, radius, pixelSize);
+    return pass;
+}
+
+// Both passes in one launch, caches the source tile plus halo in both directions
+// and the horizontally blurred rows of the tile and its vertical halo
+size_t fusedCacheSize(size_t tileWidth, size_t tileHeight, size_t radius, size_t pixelSize) {
+    auto sourceSize = (tileWidth + 2 * radius) * (tileHeight + 2 * radius);
+    auto blurredSize = tileWidth * (tileHeight + 2 * radius);
+    return (sourceSize + blurredSize) * pixelSize;
+}
+
+// Source pixels of the tile and its halo, followed by the rows blurred with either kernel, all of float pixels
+size_t differenceCacheSize(size_t tileWidth, size_t tileHeight, size_t radius, size_t pixelSize) {
+    auto sourceSize = (tileWidth + 2 * radius) * (tileHeight + 2 * radius);
+    auto blurredSize = tileWidth * (tileHeight + 2 * radius);
+    return (sourceSize + 2 * blurredSize) * pixelSize;
+}
+
+BlurPass differencePass(size_t width, size_t height, size_t pixelSize,
+                        size_t tileWidth, size_t tileHeight, size_t radius) {
+    auto pass = tiledPass(true, width, height, pixelSize, tileWidth, tileHeight, radius);
+    pass.cacheSize = differenceCacheSize(tileWidth, tileHeight, radius, pixelSize);
+    return pass;
+}
+
+BlurPass fusedPass(size_t width, size_t height, size_t pixelSize,
+                   size_t tileWidth, size_t tileHeight, size_t radius) {
+    auto pass = tiledPass(true, width, height, pixelSize, tileWidth, tileHeight, radius);
+    pass.cacheSize = fusedCacheSize(tileWidth, tileHeight, radius, pixelSize);
+    return pass;
+}
+
+// Every work-item blurs blockSize consecutive pixels of a row in registers,
+// the global work size is rounded up to whole work-groups
+BlurPass blockedPass(size_t width, size_t height, size_t blockSize, size_t tileWidth, size_t tileHeight) {
+    auto blocks = (width + blockSize - 1) / blockSize;
+    return BlurPass{
+        {(blocks + tileWidth - 1) / tileWidth * tileWidth, (height + tileHeight - 1) / tileHeight * tileHeight},
+        {tileWidth, tileHeight},
+        // the local memory argument is unused, but may not be empty
+        sizeof(cl_uchar)
+    };
+}
+
+// Every work-item filters a whole row (horizontal) or column (vertical),
+// the global work size is rounded up to whole work-groups
+BlurPass linePass(bool horizontal, size_t width, size_t height, size_t groupSize) {
+    auto lines = horizontal ? height : width;
+    return BlurPass{
+        {(lines + groupSize - 1) / groupSize * groupSize, 1},
+        {groupSize, 1},
+        // no local memory, intermediate results are kept in a global scratch buffer
+        0
+    };
+}
+
+// Launches a pass over every image of a batch, the third dimension selects the image.
+// No event is created, the passes are ordered by the in-order queue.
+void enqueuePass(OpenCL::App& app, BlurPass pass, size_t images) {
+    if (images == 1) {
+        OpenCL::enqueueKernel(app, 2, pass.globalWorkSize, pass.localWorkSize, 0, nullptr, nullptr);
+        return;
+    }
+    size_t globalWorkSize[3] = {pass.globalWorkSize[0], pass.globalWorkSize[1], images};
+    size_t localWorkSize[3] = {pass.localWorkSize[0], pass.localWorkSize[1], 1};
+    OpenCL::enqueueKernel(app, 3, globalWorkSize, localWorkSize, 0, nullptr, nullptr);
+}
+
+// One pixel per work-item of the image object kernels, the global work size is rounded up to whole work-groups
+BlurPass imagePass(size_t width, size_t height, size_t tileWidth, size_t tileHeight) {
+    return BlurPass{
+        {(width + tileWidth - 1) / tileWidth * tileWidth, (height + tileHeight - 1) / tileHeight * tileHeight},
+        {tileWidth, tileHeight},
+        // the local memory argument is unused, but may not be empty
+        sizeof(cl_uchar)
+    };
+}
+
+// One work-group per run of groupWidth pixels of a row, so every sub-group covers consecutive pixels of one row.
+// The global work size is rounded up to whole work-groups.
+BlurPass subGroupPass(size_t width, size_t height, size_t groupWidth) {
+    return BlurPass{
+        {(width + groupWidth - 1) / groupWidth * groupWidth, height},
+        {groupWidth, 1},
+        // the local memory argument is unused, but may not be empty
+        sizeof(cl_uchar)
+    };
+}
+
+// Largest radius the auto mode exchanges through sub-group shuffles. Sub-groups are at least 8 wide on common
+// devices, taps beyond the sub-group width are read from global memory.
+const size_t maxSubGroupRadius = 8;
+
+// Smallest radius of a Gaussian given by sigma that the auto mode blurs recursively,
+// the taps of wider FIR kernels cost more than the constant work of the recursive filter
+const size_t minRecursiveRadius = 16;
+
+// Coefficients of the recursive Gaussian of van Vliet, Young & Verbeek, "Recursive Gaussian derivative filters"
+// (1998), valid for sigma >= 0.5. The L2 optimized poles for a sigma of 2 are scaled by the power 1 / q, with q
+// chosen so the variance of the filter is exactly sigma squared. Its third order recursion loses too much precision
+// in float for wide blurs, so it is split into a first order section per pole (real pole & residue, complex pole &
+// residue of the conjugate pair). Followed by the steady state gains of the sections and the row-major 3x3 matrix
+// that maps the deviations of the causal section states at the last pixel to the deviations of the anti-causal start
+// states, which continues the image with its last pixel (Triggs & Sdika, 2006).
+std::vector<cl_float> recursiveCoefficients(float sigma) {
+    const std::complex<double> complexBase(1.40098, 1.00236);
+    const double realBase = 1.85132;
+    auto scaledPoles = [&](double q, std::complex<double>& complexScaled, double& realScaled) {
+        complexScaled = std::polar(std::pow(std::abs(complexBase), 1 / q), std::arg(complexBase) / q);
+        realScaled = std::pow(realBase, 1 / q);
+    };
+    // variance of the causal & anti-causal filter, 2 d / (d - 1)^2 summed over its scaled poles d, grows with q
+    auto variance = [&](double q) {
+        std::complex<double> complexScaled;
+        double realScaled;
+        scaledPoles(q, complexScaled, realScaled);
+        auto complexVariance = 2.0 * complexScaled / ((complexScaled - 1.0) * (complexScaled - 1.0));
+        return 2 * realScaled / ((realScaled - 1) * (realScaled - 1)) + 2 * complexVariance.real();
+    };
+    double low = 0, high = 2 * sigma + 1;
+    for (int i = 0; i < 64; ++i) {
+        auto q = (low + high) / 2;
+        (variance(q) < sigma * sigma ? low : high) = q;
+    }
+    std::complex<double> complexScaled;
+    double realScaled;
+    scaledPoles(low, complexScaled, realScaled);
+
+    // the poles of the causal filter in z are the inverses of the scaled poles,
+    // rounded to float first, the residues keep the gain at exactly 1 for the poles the kernels use
+    auto complexPole = 1.0 / complexScaled;
+    std::complex<double> poles[] = {
+        static_cast<cl_float>(1 / realScaled),
+        {static_cast<cl_float>(complexPole.real()), static_cast<cl_float>(complexPole.imag())},
+        {}
+    };
+    poles[2] = std::conj(poles[1]);
+    auto gain = (1.0 - poles[0]) * (1.0 - poles[1]) * (1.0 - poles[2]);
+    std::complex<double> residues[3];
+    for (int i = 0; i < 3; ++i) {
+        residues[i] = gain * poles[i] * poles[i] /
+                      ((poles[i] - poles[(i + 1) % 3]) * (poles[i] - poles[(i + 2) % 3]));
+    }
+
+    std::vector<cl_float> coefficients;
+    auto add = [&](std::complex<double> value, bool complex) {
+        coefficients.push_back(static_cast<cl_float>(value.real()));
+        if (complex) coefficients.push_back(static_cast<cl_float>(value.imag()));
+    };
+    add(poles[0], false);
+    add(poles[1], true);
+    add(residues[0], false);
+    add(residues[1], true);
+    add(residues[0] / (1.0 - poles[0]), false);
+    add(residues[1] / (1.0 - poles[1]), true);
+
+    // Past the last pixel the deviations of the causal sections decay with their poles, each anti-causal section
+    // sums them up as a geometric series. Columns are unit deviations of the real, the real & imaginary state
+    std::complex<double> deviations[3][3] = {
+        {1, 0, 0},
+        {0, 1, 1},
+        {0, {0, 1}, {0, -1}}
+    };
+    double border[3][3];
+    for (int column = 0; column < 3; ++column) {
+        std::complex<double> start[2];
+        for (int j = 0; j < 2; ++j) {
+            for (int i = 0; i < 3; ++i) {
+                start[j] += residues[j] * deviations[column][i] * poles[i] / (1.0 - poles[j] * poles[i]);
+            }
+        }
+        border[0][column] = start[0].real();
+        border[1][column] = start[1].real();
+        border[2][column] = start[1].imag();
+    }
+    for (auto& row: border) {
+        for (auto value: row) coefficients.push_back(static_cast<cl_float>(value));
+    }
+    return coefficients;
+}
+
+// Radii of the boxes whose repeated application approximates a Gaussian, Kovesi, "Fast almost-Gaussian filtering"
+// (2010). The box widths are the odd integers below and above the ideal width, the number of narrower boxes
+// is chosen so the variances of the boxes add up to sigma squared as closely as possible
+std::vector<int> boxRadii(float sigma, int boxes) {
+    auto variance = 12.0 * sigma * sigma;
+    auto lower = static_cast<int>(std::floor(std::sqrt(variance / boxes + 1)));
+    if (lower % 2 == 0) lower--;
+    auto upper = lower + 2;
+    auto narrower = std::lround((variance - boxes * lower * lower - 4 * boxes * lower - 3 * boxes) / (-4 * lower - 4));
+    std::vector<int> radii;
+    for (int i = 0; i < boxes; ++i) {
+        radii.push_back(((i < narrower ? lower : upper) - 1) / 2);
+    }
+    return radii;
+}
+
+struct Pyramid {
+    int levels;
+    // Gaussian left for the coarsest level, in pixels of it
+    float residualSigma;
+};
+
+// Levels of the pyramid mode for a Gaussian of the given sigma. The image is halved while the Gaussian left
+// for the next level keeps a sigma of at least 2 of its pixels and the level at least 16 pixels per direction.
+// Every downsampling adds the variance of its anti-alias filter, 3/4 of a pixel of its source level squared,
+// the bilinear upsampling adds that of a triangle as wide as two pixels of the coarsest level.
+Pyramid pyramidLevels(float sigma, int width, int height) {
+    const double minResidualSigma = 2;
+    const int minLevelSize = 16;
+    auto residualVariance = [&](int levels) {
+        double variance = sigma * sigma;
+        double scale = 1;
+        for (int level = 0; level < levels; ++level) {
+            variance -= 0.75 * scale * scale;
+            scale *= 2;
+        }
+        if (levels > 0) variance -= scale * scale / 6;
+        return variance / (scale * scale);
+    };
+    int levels = 0;
+    while (residualVariance(levels + 1) >= minResidualSigma * minResidualSigma &&
+           std::min(width, height) >> (levels + 1) >= minLevelSize) {
+        levels++;
+    }
+    return Pyramid{levels, static_cast<float>(std::sqrt(std::max(residualVariance(levels), 0.0)))};
+}
+
+// Largest local memory cache of the passes of a tile based mode
+size_t maxTileCacheSize(BlurMode mode, size_t tileWidth, size_t tileHeight, size_t radius, size_t pixelSize) {
+    auto horizontalSize = tileCacheSize(true, tileWidth, tileHeight, radius, pixelSize);
+    switch (mode) {
+        case BlurMode::Transposed:
+            return std::max(horizontalSize, transposedCacheSize(tileWidth, tileHeight, radius, pixelSize));
+        case BlurMode::Fused:
+            return fusedCacheSize(tileWidth, tileHeight, radius, pixelSize);
+        case BlurMode::Dog:
+        case BlurMode::Log:
+            return differenceCacheSize(tileWidth, tileHeight, radius, pixelSize);
+        case BlurMode::Subgroup:
+            return tileCacheSize(false, tileWidth, tileHeight, radius, pixelSize);
+        case BlurMode::Blocked:
+        case BlurMode::Gray:
+        case BlurMode::Recursive:
+        case BlurMode::Box:
+        case BlurMode::Image:
+            return sizeof(cl_uchar);
+        default:
+            return std::max(horizontalSize, tileCacheSize(false, tileWidth, tileHeight, radius, pixelSize));
+    }
+}
+
+// Halve the tile until it fits into a work-group and its halo into local memory
+bool fitTile(BlurMode mode, size_t& tileWidth, size_t& tileHeight, size_t radius, size_t pixelSize,
+             size_t maxWorkGroupSize, const size_t* maxWorkItemSizes, cl_ulong maxLocalMemory) {
+    tileWidth = std::min(tileWidth, maxWorkItemSizes[0]);
+    tileHeight = std::min(tileHeight, maxWorkItemSizes[1]);
+    auto cacheSize = [&]() {
+        return maxTileCacheSize(mode, tileWidth, tileHeight, radius, pixelSize);
+    };
+    while (tileWidth * tileHeight > maxWorkGroupSize || maxLocalMemory < cacheSize()) {
+        if (tileWidth == 1 && tileHeight == 1) return false;
+        if (tileWidth >= tileHeight) tileWidth /= 2;
+        else tileHeight /= 2;
+    }
+    return true;
+}
+
+// Weights in 1.15 fixed point. They are normalized, rounded to nearest and the rounding error is added
+// to the center weight, so they sum up to exactly 1 << 15 and stay symmetric.
+// The kernels round the sums, 8-bit results of Gaussians differ by at most 2 from the truncating float kernels.
+std::optional<std::vector<cl_ushort>> fixedPointWeights(const SmoothKernel& smoothKernel) {
+    const int one = 1 << 15;
+    double sum = 0;
+    for (int i = 0; i < smoothKernel.dimension; ++i) {
+        if (smoothKernel.data[i] < 0) return std::nullopt;
+        sum += smoothKernel.data[i];
+    }
+    if (sum <= 0) return std::nullopt;
+
+    std::vector<int> weights(smoothKernel.dimension);
+    int fixedSum = 0;
+    for (int i = 0; i < smoothKernel.dimension; ++i) {
+        weights[i] = static_cast<int>(std::lround(smoothKernel.data[i] / sum * one));
+        fixedSum += weights[i];
+    }
+    auto& center = weights[smoothKernel.dimension / 2];
+    center += one - fixedSum;
+    if (center < 0 || center > one) return std::nullopt;
+    return std::vector<cl_ushort>(weights.begin(), weights.end());
+}
+
+// Largest radius whose half precision sums stay within 1 of the float sums of 8-bit pixels.
+// Every tap adds a rounding error of up to 1/16 (half an ulp of values up to 255).
+const size_t maxHalfPrecisionRadius = 4;
+
+// Build options shared by the generic and the specialized kernel variants
+std::string baseOptions(const SmoothKernel& smoothKernel, const Image& image) {
+    const char* pixelTypes[] = {"uchar", "ushort", "float"};
+    auto options = "-DCHANNELS=" + std::to_string(image.channels) +
+                   " -DPIXEL_TYPE=" + pixelTypes[static_cast<int>(image.type)];
+    // asymmetric kernels fall back to one multiply per tap
+    if (smoothKernel.symmetric) {
+        options += " -DSYMMETRIC";
+    }
+    return options;
+}
+
+// Build options of a kernel variant specialized for the given smooth kernel and channel count,
+// the weights are passed as exact hexadecimal float literals so the loops can be fully unrolled.
+// Both directions are entry points of the same program.
+std::string specializationOptions(const SmoothKernel& smoothKernel, const Image& image,
+                                  const std::optional<std::vector<cl_ushort>>& fixedPointWeights) {
+    auto options = baseOptions(smoothKernel, image) + " -DRADIUS=" + std::to_string(smoothKernel.dimension / 2);
+    if (fixedPointWeights.has_value()) {
+        options += " -DFIXED_POINT -DSMOOTH_KERNEL=";
+        for (size_t i = 0; i < fixedPointWeights->size(); ++i) {
+            options += (i > 0 ? "," : "") + std::to_string((*fixedPointWeights)[i]);
+        }
+        return options;
+    }
+    options += " -DSMOOTH_KERNEL=";
+    char weight[32];
+    for (int i = 0; i < smoothKernel.dimension; ++i) {
+        snprintf(weight, sizeof(weight), "%s%af", i > 0 ? "," : "", smoothKernel.data[i]);
+        options += weight;
+    }
+    return options;
+}
+
+// Build option of a border mode other than clamp, the default of the kernels
+std::string borderOptions(BorderMode border) {
+    const char* borders[] = {"BORDER_CLAMP", "BORDER_MIRROR", "BORDER_WRAP", "BORDER_CONSTANT"};
+    return border == BorderMode::Clamp ? "" : std::string(" -DBORDER=") + borders[static_cast<int>(border)];
+}
+
+// Build options of the unsharp mask applied by the last pass, integer pixels are clamped to their range
+std::string sharpenOptions(float amount, float threshold, const Image& image) {
+    char options[96];
+    snprintf(options, sizeof(options), " -DSHARPEN_AMOUNT=%af -DSHARPEN_THRESHOLD=%af", amount, threshold);
+    const char* pixelMaxima[] = {" -DPIXEL_MAX=255.0f", " -DPIXEL_MAX=65535.0f", ""};
+    return options + std::string(pixelMaxima[static_cast<int>(image.type)]);
+}
+
+// Build options of the dog and log kernels, their signed results are offset by half the range of integer pixels,
+// float pixels store the signed results
+std::string differenceOptions(bool laplacian, const Image& image) {
+    const char* offsets[] = {" -DDIFFERENCE_OFFSET=128.0f", " -DDIFFERENCE_OFFSET=32768.0f", ""};
+    return std::string(" -DDIFFERENCE") + (laplacian ? " -DLAPLACIAN" : "") + offsets[static_cast<int>(image.type)];
+}
+
+// Build option of the table decoding 8-bit sRGB components to 16-bit linear light
+std::string linearLightOptions() {
+    std::string options = " -DSRGB_TO_LINEAR=";
+    for (int i = 0; i < 256; ++i) {
+        auto value = i / 255.0;
+        auto linear = value <= 0.04045 ? value / 12.92 : std::pow((value + 0.055) / 1.055, 2.4);
+        options += (i > 0 ? "," : "") + std::to_string(std::lround(linear * 65535));
+    }
+    return options;
+}
+
+// Additional build options of a recursive kernel variant specialized for the given coefficients
+std::string recursiveSpecializationOptions(const std::vector<cl_float>& coefficients) {
+    std::string options = " -DRECURSIVE_COEFFICIENTS=";
+    char coefficient[32];
+    for (size_t i = 0; i < coefficients.size(); ++i) {
+        snprintf(coefficient, sizeof(coefficient), "%s%af", i > 0 ? "," : "", coefficients[i]);
+        options += coefficient;
+    }
+    return options;
+}
+
+// Additional build options of a box kernel variant specialized for the given radii
+std::string boxSpecializationOptions(const std::vector<int>& radii) {
+    std::string options = " -DBOX_RADII=";
+    for (size_t i = 0; i < radii.size(); ++i) {
+        options += (i > 0 ? "," : "") + std::to_string(radii[i]);
+    }
+    return options;
+}
+
+// Downsamples the image to the coarsest level of a pyramid with at least one level, blurs it there with the tiled kernels
+// and upsamples it back. Every level is a float buffer on the device, only the output is read back.
+void* blurPyramid(OpenCL::App& app, const Image& image, SmoothKernel& smoothKernel, int levels,
+                  size_t tileWidth, size_t tileHeight, bool specialize) {
+    auto levelImage = image;
+    levelImage.type = PixelType::Float;
+    levelImage.pixelSize = image.channels * sizeof(cl_float);
+    auto pyramidOptions = " -DPYRAMID=" + std::to_string(levels);
+    auto imageOptions = baseOptions(smoothKernel, image) + pyramidOptions;
+    auto levelOptions = baseOptions(smoothKernel, levelImage) + pyramidOptions;
+    auto blurOptions = levelOptions;
+    if (specialize) {
+        blurOptions = specializationOptions(smoothKernel, levelImage, std::nullopt) + pyramidOptions;
+    }
+    size_t radius = smoothKernel.dimension / 2;
+    size_t localWorkSize[2] = {tileWidth, tileHeight};
+    auto levelSize = [&](cl_int width, cl_int height) {
+        return width * height * levelImage.pixelSize;
+    };
+
+    // the level size is passed by value, the arguments are set again with every kernel
+    cl_int levelWidth = image.width;
+    cl_int levelHeight = image.height;
+    auto sourceArg = OpenCL::addArgument(
+        app, "imageInput", 0, image.data,
+        [](void* pointer) { stbi_image_free(pointer); },
+        image.size, CL_MEM_READ_ONLY, true
+    );
+    OpenCL::addScalarArgument(app, "width", 2, &levelWidth, sizeof(cl_int));
+    OpenCL::addScalarArgument(app, "height", 3, &levelHeight, sizeof(cl_int));
+    OpenCL::addArgument(
+        app, "smoothKernel", 4, smoothKernel.data, std::nullopt,
+        smoothKernel.size, CL_MEM_READ_ONLY, true
+    );
+    OpenCL::addScalarArgument(app, "smoothKernelDimension", 5, &smoothKernel.dimension, sizeof(cl_int));
+    // the resampling kernels use no local memory, but it may not be empty
+    auto pixelArg = OpenCL::addLocalArgument(app, "pixel", 6, sizeof(cl_uchar));
+
+    // the destination becomes the source of the next launch
+    auto nextLevel = [&](cl_int width, cl_int height) {
+        OpenCL::removeArgument(app, sourceArg);
+        sourceArg = app.arguments[1];
+        OpenCL::changeArgumentIndex(app, sourceArg, 0);
+        levelWidth = width;
+        levelHeight = height;
+    };
+    auto roundUp = [](size_t size, size_t multiple) {
+        return (size + multiple - 1) / multiple * multiple;
+    };
+
+    // halve the image with an anti-alias filter per level, from the image type to float
+    for (int level = 1; level <= levels; ++level) {
+        cl_int width = (levelWidth + 1) / 2;
+        cl_int height = (levelHeight + 1) / 2;
+        OpenCL::addArgument(
+            app, "level", 1, nullptr, std::nullopt,
+            levelSize(width, height), CL_MEM_READ_WRITE, false
+        );
+        OpenCL::createKernel(
+            app, "kernel/gaussian_blur.cl", "gaussian_blur_downsample", level == 1 ? imageOptions : levelOptions
+        );
+        size_t globalWorkSize[2] = {roundUp(width, tileWidth), roundUp(height, tileHeight)};
+        OpenCL::enqueueKernel(app, 2, globalWorkSize, localWorkSize, 0, nullptr, nullptr);
+        nextLevel(width, height);
+    }
+    // blur the coarsest level horizontally & vertically, the vertical pass writes back to the coarsest level
+    auto tmpArg = OpenCL::addArgument(
+        app, "level", 1, nullptr, std::nullopt,
+        levelSize(levelWidth, levelHeight), CL_MEM_READ_WRITE, false
+    );
+    for (bool horizontal: {true, false}) {
+        auto pass = tiledPass(
+            horizontal, levelWidth, levelHeight, levelImage.pixelSize, tileWidth, tileHeight, radius
+        );
+        OpenCL::removeArgument(app, pixelArg);
+        pixelArg = OpenCL::addLocalArgument(app, "pixel", 6, pass.cacheSize);
+        OpenCL::createKernel(
+            app, "kernel/gaussian_blur.cl", horizontal ? "gaussian_blur_tiled_h" : "gaussian_blur_tiled_v", blurOptions
+        );
+        OpenCL::enqueueKernel(app, 2, pass.globalWorkSize, pass.localWorkSize, 0, nullptr, nullptr);
+        OpenCL::swapArgumentIndices(app, sourceArg, tmpArg);
+    }
+
+    // interpolate back to the full resolution
+    OpenCL::removeArgument(app, tmpArg);
+    levelWidth = image.width;
+    levelHeight = image.height;
+    auto* output = malloc(image.size);
+    auto outputArg = OpenCL::addArgument(
+        app, "imageOutput", 1, output,
+        [](void* pointer) { free(pointer); },
+        image.size, CL_MEM_WRITE_ONLY, false
+    );
+    OpenCL::createKernel(app, "kernel/gaussian_blur.cl", "gaussian_blur_upsample", imageOptions);
+    size_t globalWorkSize[2] = {roundUp(image.width, tileWidth), roundUp(image.height, tileHeight)};
+    OpenCL::enqueueKernel(app, 2, globalWorkSize, localWorkSize, 0, nullptr, nullptr);
+
+    // read the device output buffer to the host output array
+    OpenCL::readBuffer(app, outputArg, CL_TRUE);
+    return output;
+}
+
+// Image object format of the image kernel. There are no three channel formats of 8 & 16-bit components,
+// so RGB images are padded to RGBA.
+cl_image_format imageObjectFormat(const Image& image) {
+    cl_image_format format;
+    format.image_channel_order = image.channels == 1 ? CL_R : image.channels == 2 ? CL_RG : CL_RGBA;
+    format.image_channel_data_type = image.type == PixelType::UChar ? CL_UNORM_INT8 :
+                                     image.type == PixelType::UShort ? CL_UNORM_INT16 : CL_FLOAT;
+    return format;
+}
+
+// Blurs the image with the image object kernel, the intermediate image stays on the device. The input is copied,
+// all arguments are removed again, so the buffer kernels can still blur the same image afterwards.
+// When benchmarking, an untimed run warms up both kernels first and only the passes of the second run are timed.
+void* blurImage(OpenCL::App& app, const Image& image, SmoothKernel& smoothKernel, BorderMode border,
+                size_t tileWidth, size_t tileHeight, bool specialize, double* seconds = nullptr) {
+    auto format = imageObjectFormat(image);
+    size_t pixels = static_cast<size_t>(image.width) * image.height;
+    auto padded = image.channels == 3;
+    auto objectPixelSize = padded ? image.pixelSize / 3 * 4 : image.pixelSize;
+    auto* input = image.data;
+    std::optional<std::function<void(void*)>> freeInput;
+    if (padded) {
+        input = calloc(pixels, objectPixelSize);
+        for (size_t i = 0; i < pixels; ++i) {
+            memcpy(static_cast<char*>(input) + i * objectPixelSize,
+                   static_cast<const char*>(image.data) + i * image.pixelSize, image.pixelSize);
+        }
+        freeInput = [](void* pointer) { free(pointer); };
+    }
+    auto imageOptions = " -DIMAGE" + borderOptions(border);
+    auto genericOptions = baseOptions(smoothKernel, image) + imageOptions;
+    auto kernelOptions = genericOptions;
+    if (specialize) {
+        kernelOptions = specializationOptions(smoothKernel, image, std::nullopt) + imageOptions;
+    }
+    auto pass = imagePass(image.width, image.height, tileWidth, tileHeight);
+
+    cl_int width = image.width;
+    cl_int height = image.height;
+    // the vertical pass writes back into the input image
+    auto inputArg = OpenCL::addImageArgument(
+        app, "imageInput", 0, input, freeInput,
+        image.width, image.height, format, CL_MEM_READ_WRITE, true
+    );
+    auto tmpArg = OpenCL::addImageArgument(
+        app, "imageOutput", 1, nullptr, std::nullopt,
+        image.width, image.height, format, CL_MEM_READ_WRITE, false
+    );
+    OpenCL::addScalarArgument(app, "width", 2, &width, sizeof(cl_int));
+    OpenCL::addScalarArgument(app, "height", 3, &height, sizeof(cl_int));
+    OpenCL::addArgument(
+        app, "smoothKernel", 4, smoothKernel.data, std::nullopt,
+        smoothKernel.size, CL_MEM_READ_ONLY, true
+    );
+    OpenCL::addScalarArgument(app, "smoothKernelDimension", 5, &smoothKernel.dimension, sizeof(cl_int));
+    OpenCL::addLocalArgument(app, "pixel", 6, pass.cacheSize);
+
+    auto runs = seconds != nullptr ? 2 : 1;
+    std::chrono::steady_clock::time_point start;
+    for (int run = 0; run < runs; ++run) {
+        if (run > 0) {
+            // the warm-up run overwrote the input
+            OpenCL::writeBuffer(app, inputArg, CL_TRUE);
+            start = std::chrono::steady_clock::now();
+        }
+        OpenCL::createKernel(app, "kernel/gaussian_blur.cl", "gaussian_blur_image_h", kernelOptions);
+        OpenCL::enqueueKernel(app, 2, pass.globalWorkSize, pass.localWorkSize, 0, nullptr, nullptr);
+        // the intermediate image becomes the input of the vertical pass
+        OpenCL::swapArgumentIndices(app, inputArg, tmpArg);
+        OpenCL::createKernel(app, "kernel/gaussian_blur.cl", "gaussian_blur_image_v", kernelOptions);
+        OpenCL::enqueueKernel(app, 2, pass.globalWorkSize, pass.localWorkSize, 0, nullptr, nullptr);
+        OpenCL::finish(app);
+        OpenCL::swapArgumentIndices(app, inputArg, tmpArg);
+    }
+    if (seconds != nullptr) *seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    auto* output = malloc(pixels * objectPixelSize);
+    OpenCL::readBuffer(app, inputArg, output, pixels * objectPixelSize, CL_TRUE);
+
+    // leave no arguments behind for the kernels that run next
+    auto arguments = app.arguments;
+    for (auto& [_, arg]: arguments) {
+        OpenCL::removeArgument(app, arg);
+    }
+
+    if (padded) {
+        auto* unpadded = malloc(image.size);
+        for (size_t i = 0; i < pixels; ++i) {
+            memcpy(static_cast<char*>(unpadded) + i * image.pixelSize,
+                   static_cast<const char*>(output) + i * objectPixelSize, image.pixelSize);
+        }
+        free(output);
+        output = unpadded;
+    }
+    return output;
+}
+
+// Launch configuration of both passes of a mode for an image, or a region of it, of the given size.
+// The fused, dog and log modes have a single pass.
+void modePasses(BlurMode mode, size_t width, size_t height, size_t pixelSize, size_t tileWidth, size_t tileHeight,
+                size_t radius, size_t blockSize, size_t subGroupWidth,
+                BlurPass& horizontalPass, BlurPass& verticalPass) {
+    if (mode == BlurMode::Row) {
+        horizontalPass = rowPass(true, width, height, pixelSize);
+        verticalPass = rowPass(false, width, height, pixelSize);
+    } else if (mode == BlurMode::Tiled) {
+        horizontalPass = tiledPass(true, width, height, pixelSize, tileWidth, tileHeight, radius);
+        verticalPass = tiledPass(false, width, height, pixelSize, tileWidth, tileHeight, radius);
+    } else if (mode == BlurMode::Transposed) {
+        horizontalPass = tiledPass(true, width, height, pixelSize, tileWidth, tileHeight, radius);
+        verticalPass = transposedPass(width, height, pixelSize, tileWidth, tileHeight, radius);
+    } else if (mode == BlurMode::Blocked) {
+        horizontalPass = blockedPass(width, height, blockSize, tileWidth, tileHeight);
+        verticalPass = horizontalPass;
+    } else if (mode == BlurMode::Gray) {
+        horizontalPass = blockedPass(width, height, 16, tileWidth, tileHeight);
+        verticalPass = horizontalPass;
+    } else if (mode == BlurMode::Recursive || mode == BlurMode::Box) {
+        horizontalPass = linePass(true, width, height, tileWidth);
+        verticalPass = linePass(false, width, height, tileWidth);
+    } else if (mode == BlurMode::Subgroup) {
+        horizontalPass = subGroupPass(width, height, subGroupWidth);
+        verticalPass = tiledPass(false, width, height, pixelSize, tileWidth, tileHeight, radius);
+    } else if (mode == BlurMode::Dog || mode == BlurMode::Log) {
+        horizontalPass = differencePass(width, height, pixelSize, tileWidth, tileHeight, radius);
+    } else {
+        horizontalPass = fusedPass(width, height, pixelSize, tileWidth, tileHeight, radius);
+    }
+}
+
+// Part of the image the blur of a region of interest depends on, the region grown by the radius and clipped to the
+// image. The wrap border reads the opposite side of the image, so a halo beyond an edge spans the whole image.
+Region haloRegion(const Region& roi, size_t radius, size_t width, size_t height, BorderMode border) {
+    auto grow = [&](size_t start, size_t size, size_t limit, size_t& haloStart, size_t& haloSize) {
+        auto beyondEdge = start < radius || start + size + radius > limit;
+        haloStart = border == BorderMode::Wrap && beyondEdge ? 0 : start - std::min(start, radius);
+        auto haloEnd = border == BorderMode::Wrap && beyondEdge ? limit : std::min(start + size + radius, limit);
+        haloSize = haloEnd - haloStart;
+    };
+    Region halo{};
+    grow(roi.x, roi.width, width, halo.x, halo.width);
+    grow(roi.y, roi.height, height, halo.y, halo.height);
+    return halo;
+}
+
+int main(int argc, char** argv) {
+    printf("gaussian-blur\n");
+    std::vector<std::string> args(&argv[0], &argv[0 + argc]);
+    args.erase(args.begin());
+
+    auto options = parseOptions(args);
+
+    // the images of a batch are blurred together, one launch per pass for all of them
+    std::vector<std::string> filenames = {options.filename};
+    if (!options.batchList.empty()) filenames = readBatchList(options.batchList);
+    auto images = filenames.size();
+
     printf("Parameters:\n");
-    printf("  File: %s\n", filename.c_str());
-    printf("  Kernel: %s\n", kernelInput.c_str());
+    if (options.batchList.empty()) {
+        printf("  File: %s\n", options.filename.c_str());
+    } else {
+        printf("  Batch: %zu images listed in %s\n", images, options.batchList.c_str());
+    }
+    if (!options.scales.empty()) {
+        printf("  Scales: %zu sigmas from %g to %g\n",
+               options.scales.size(), options.scales.front(), options.scales.back());
+    } else if (options.sigma > 0) {
+        printf("  Sigma: %g\n", options.sigma);
+    } else {
+        printf("  Kernel: %s\n", options.kernelInput.c_str());
+    }
 
-    auto imageInput = loadImage(filename);
+    auto imageInput = options.batchList.empty() ? loadImage(options.filename) : loadBatch(filenames);
     size_t width = imageInput.width;
     size_t height = imageInput.height;
     auto channels = imageInput.channels;
-    auto* tmpImage = static_cast<cl_uchar*>(malloc(imageInput.size));
-    auto smoothKernel = loadSmoothKernel(kernelInput);
+    auto pixelSize = imageInput.pixelSize;
+    auto batchSize = imageInput.size * images;
+    auto* tmpImage = static_cast<cl_uchar*>(malloc(batchSize));
+    auto smoothKernel = options.sigma > 0 ? gaussianSmoothKernel(options.sigma) : loadSmoothKernel(options.kernelInput);
+    size_t radius = smoothKernel.dimension / 2;
+
+    // every level of a scale space after the first blurs the previous level with what is left of its Gaussian,
+    // the levels cascade on the device from one upload of the input. Tiles and caches fit the widest kernel.
+    // The dog and log modes instead blur every output from the input with a pair of kernels, the Gaussians of
+    // neighbouring sigmas or a Gaussian and its second derivative.
+    auto differenceMode = options.mode == BlurMode::Dog || options.mode == BlurMode::Log;
+    if (options.mode == BlurMode::Dog && options.scales.empty()) {
+        printf("Error: The dog mode needs --scales\n");
+        exit(EXIT_FAILURE);
+    }
+    if (options.mode == BlurMode::Log && options.sigma == 0) {
+        printf("Error: The log mode needs --sigma or --scales\n");
+        exit(EXIT_FAILURE);
+    }
+    std::vector<SmoothKernel> levelKernels = {smoothKernel};
+    std::vector<float> residualSigmas = {options.sigma};
+    if (differenceMode) {
+        free(smoothKernel.data);
+        levelKernels.clear();
+        auto sigmas = options.scales.empty() ? std::vector<float>{options.sigma} : options.scales;
+        for (size_t i = 0; i < sigmas.size(); ++i) {
+            if (options.mode == BlurMode::Log) levelKernels.push_back(laplacianOfGaussianKernel(sigmas[i]));
+            else if (i > 0) levelKernels.push_back(differenceOfGaussiansKernel(sigmas[i - 1], sigmas[i]));
+        }
+        smoothKernel = levelKernels.front();
+        radius = smoothKernel.dimension / 2;
+    }
+    for (size_t i = 1; i < options.scales.size() && !differenceMode; ++i) {
+        auto sigma = options.scales[i];
+        auto previous = options.scales[i - 1];
+        residualSigmas.push_back(std::sqrt(sigma * sigma - previous * previous));
+        levelKernels.push_back(gaussianSmoothKernel(residualSigmas.back()));
+    }
+    for (auto& levelKernel: levelKernels) {
+        radius = std::max(radius, static_cast<size_t>(levelKernel.dimension / 2));
+    }
+    auto levels = levelKernels.size();
+
+    // linear light blurs 8-bit sRGB images as 16-bit linear pixels, the kernels and their caches are built for those
+    auto linearLight = options.linearLight && imageInput.type == PixelType::UChar;
+    if (options.linearLight && !linearLight) {
+        printf("Kernels: linear light needs 8-bit images, blurring the stored values\n");
+    }
+    // premultiplied alpha blurs integer images with an alpha channel as 16-bit premultiplied pixels
+    auto premultiply = options.premultipliedAlpha && (channels == 2 || channels == 4) &&
+                       imageInput.type != PixelType::Float;
+    if (options.premultipliedAlpha && !premultiply) {
+        printf("Kernels: premultiplied alpha needs integer images with an alpha channel, blurring the stored values\n");
+    }
+    // both convert the image in the first and last pass only
+    auto convertImage = linearLight || premultiply;
+    auto kernelImage = imageInput;
+    if (convertImage) {
+        kernelImage.type = PixelType::UShort;
+        kernelImage.pixelSize = channels * sizeof(cl_ushort);
+    }
+
+    // batches run the convolution kernels with a third launch dimension only,
+    // regions of interest need a halo of no more than the radius, the unsharp mask, linear light and
+    // premultiplied alpha are applied by the loads and stores of the convolution kernels, and the levels of
+    // a scale space swap their kernels between the launches of the convolution kernels
+    auto convolutionOnly = images > 1 || !options.rois.empty() || options.sharpenAmount > 0 || convertImage ||
+                           levels > 1 || differenceMode;
+    if (images > 1 && !options.rois.empty()) {
+        printf("Error: Regions of interest can not be combined with a batch\n");
+        exit(EXIT_FAILURE);
+    }
+    if (differenceMode && (images > 1 || !options.rois.empty() || options.sharpenAmount > 0 || convertImage)) {
+        printf("Error: The dog and log modes can not be combined with a batch, regions of interest, sharpening, "
+               "linear light or premultiplied alpha\n");
+        exit(EXIT_FAILURE);
+    }
+    if (levels > 1 && (images > 1 || !options.rois.empty() || options.sharpenAmount > 0)) {
+        printf("Error: A scale space can not be combined with a batch, regions of interest or sharpening\n");
+        exit(EXIT_FAILURE);
+    }
+    if (convertImage && (images > 1 || options.sharpenAmount > 0)) {
+        printf("Error: Linear light and premultiplied alpha can not be combined with a batch or sharpening\n");
+        exit(EXIT_FAILURE);
+    }
+    for (auto& roi: options.rois) {
+        if (roi.x + roi.width > static_cast<size_t>(imageInput.width) ||
+            roi.y + roi.height > static_cast<size_t>(imageInput.height)) {
+            printf("Error: The region of interest at %zu,%zu of %zux%zu pixels exceeds the image\n",
+                   roi.x, roi.y, roi.width, roi.height);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (convolutionOnly && (options.mode == BlurMode::Recursive || options.mode == BlurMode::Box ||
+                            options.mode == BlurMode::Pyramid || options.mode == BlurMode::Image)) {
+        printf("Mode: batches, regions of interest, sharpening, linear light, premultiplied alpha and scale spaces "
+               "need a convolution mode, falling back to tiled\n");
+        options.mode = BlurMode::Tiled;
+    }
+    if (convertImage && (options.mode == BlurMode::Blocked || options.mode == BlurMode::Gray ||
+                         options.mode == BlurMode::Subgroup)) {
+        printf("Mode: linear light and premultiplied alpha need the row, tiled, transposed or fused mode, "
+               "falling back to tiled\n");
+        options.mode = BlurMode::Tiled;
+    }
+    if (convolutionOnly && options.benchmark) {
+        printf("Benchmark: image objects only blur single whole images, only the buffer kernels run\n");
+        options.benchmark = false;
+    }
+
+    // the pyramid mode blurs its coarsest level with what is left of the Gaussian
+    Pyramid pyramid{0, 0};
+    if (options.mode == BlurMode::Pyramid) {
+        if (options.sigma == 0) {
+            printf("Error: The pyramid mode needs --sigma\n");
+            exit(EXIT_FAILURE);
+        }
+        pyramid = pyramidLevels(options.sigma, imageInput.width, imageInput.height);
+        if (pyramid.levels == 0) {
+            printf("Mode: pyramid needs a wider Gaussian or a larger image, falling back to tiled\n");
+            options.mode = BlurMode::Tiled;
+        } else {
+            free(smoothKernel.data);
+            smoothKernel = gaussianSmoothKernel(pyramid.residualSigma);
+            radius = smoothKernel.dimension / 2;
+        }
+    }
 
     // select the platform
     // retrieve the number of devices
@@ -131,40 +1423,417 @@ int main(int argc, char** argv) {
     // create context
     // create command queue
     auto app = OpenCL::setup();
-    cl_bool isHorizontal = true;
 
-    // allocate buffers
+    // a benchmark recorded for the device lets the auto mode pick image objects where they were faster
+    auto deviceName = OpenCL::deviceName(app);
+    auto recordedImages = options.mode == BlurMode::Auto && !convolutionOnly && !options.benchmark &&
+                          recordedBenchmark(deviceName) == "image";
+    // image objects need the support of the device for their format & size
+    auto imagesFit = (options.mode == BlurMode::Image || options.benchmark || recordedImages) &&
+                     OpenCL::supportsImageFormat(app, imageObjectFormat(imageInput), CL_MEM_READ_WRITE, width, height);
+    if (options.mode == BlurMode::Image && !imagesFit) {
+        printf("Mode: image objects are not supported, falling back to tiled\n");
+        options.mode = BlurMode::Tiled;
+    }
+
+    // check device capabilities
+    // check if image fits into a single work-group per row/column, otherwise fall back to tiles
+    auto mode = options.mode;
+    auto isCpu = (OpenCL::deviceType(app) & CL_DEVICE_TYPE_CPU) != 0;
+    auto tileWidth = options.tileWidth;
+    auto tileHeight = options.tileHeight;
+    size_t subGroupWidth = 0;
+    auto deviceVersion = OpenCL::deviceVersion(app);
+    // the sub-group built-ins come with cl_khr_subgroups, are core in OpenCL 2.1 and 2.2 and the optional
+    // __opencl_c_subgroups feature in OpenCL 3.0, the programs are built with the OpenCL C version providing them
+    std::string subGroupStd;
+    auto subGroups = OpenCL::supportsExtension(app, "cl_khr_subgroups");
+    if (!subGroups && OpenCL::supportsOpenCLCFeature(app, "__opencl_c_subgroups")) {
+        subGroups = true;
+        subGroupStd = " -cl-std=CL3.0";
+    } else if (!subGroups && deviceVersion >= 21 && deviceVersion < 30) {
+        subGroups = true;
+        subGroupStd = " -cl-std=CL2.0";
+    }
+    OpenCL::checkDeviceCapabilities(app, [&](
+        auto maxWorkGroupSize, auto maxWorkItemDimensions, auto* maxWorkItemSizes, auto maxLocalMemory
+    ) {
+        if (maxWorkItemDimensions < 2) return false;
+        auto maxCachingSize = std::max(width, height) * kernelImage.pixelSize;
+        auto rowFits = maxWorkItemSizes[0] >= width && maxWorkItemSizes[1] >= height &&
+                       maxWorkGroupSize >= std::max(width, height) && maxLocalMemory >= maxCachingSize;
+        // linear light and premultiplied alpha are converted by the local memory kernels only
+        if (mode == BlurMode::Auto && convertImage) mode = rowFits ? BlurMode::Row : BlurMode::Tiled;
+        // wide Gaussians are blurred recursively, at a constant cost per pixel
+        if (mode == BlurMode::Auto && !convolutionOnly && options.sigma >= 0.5f && radius >= minRecursiveRadius) {
+            mode = BlurMode::Recursive;
+        }
+        if (mode == BlurMode::Recursive && options.sigma < 0.5f) {
+            printf("Error: The recursive mode needs --sigma with a value of at least 0.5\n");
+            return false;
+        }
+        if (mode == BlurMode::Box && options.sigma == 0) {
+            printf("Error: The box mode needs --sigma\n");
+            return false;
+        }
+        if (mode == BlurMode::Auto && recordedImages && imagesFit) {
+            printf("Mode: image objects were faster in the benchmark recorded for this device\n");
+            mode = BlurMode::Image;
+        }
+        // grayscale images have their own vectorized kernel
+        if (mode == BlurMode::Auto && channels == 1) mode = BlurMode::Gray;
+        // CPU devices vectorize whole blocks of pixels per work-item best
+        if (mode == BlurMode::Auto && isCpu) mode = BlurMode::Blocked;
+        // small radii are exchanged between the work-items of a sub-group in the horizontal pass
+        auto subGroupShuffles = subGroups && OpenCL::supportsExtension(app, "cl_khr_subgroup_shuffle");
+        if (mode == BlurMode::Auto && subGroupShuffles && radius <= maxSubGroupRadius) mode = BlurMode::Subgroup;
+        if (mode == BlurMode::Subgroup && !subGroupShuffles) {
+            printf("Mode: sub-group shuffles or sub-groups are not supported, falling back to tiled\n");
+            mode = BlurMode::Tiled;
+        }
+        if (mode == BlurMode::Gray && channels != 1) {
+            printf("Error: The gray mode needs a single channel image\n");
+            return false;
+        }
+        if (mode == BlurMode::Auto) mode = rowFits ? BlurMode::Row : BlurMode::Tiled;
+        if (mode == BlurMode::Row) return rowFits;
+        // the pyramid levels are float images, the difference kernels cache float pixels
+        if (!fitTile(
+            mode, tileWidth, tileHeight, radius,
+            mode == BlurMode::Pyramid || differenceMode ? channels * sizeof(cl_float) : kernelImage.pixelSize,
+            maxWorkGroupSize, maxWorkItemSizes, maxLocalMemory
+        )) return false;
+        // the horizontal sub-group pass runs as many work-items per work-group as a tile, all in one row
+        subGroupWidth = std::min(tileWidth * tileHeight, maxWorkItemSizes[0]);
+        return true;
+    });
+
+    // the blocked mode works on the pixels of a vload16 by default, but on at least 4 of them, devices preferring
+    // wider char vectors get as many pixels as fill one (GPUs often prefer scalars, which would not block at all)
+    auto blockSize = options.blockSize;
+    if (mode == BlurMode::Blocked && blockSize == 0) {
+        blockSize = std::max<size_t>(4, 16 / channels);
+        blockSize = std::max<size_t>(blockSize, OpenCL::preferredVectorWidthChar(app) / channels);
+    }
+
+    // the recursive & box filters and the pyramid resampling continue the image with its edge pixels
+    auto border = options.border;
+    if ((mode == BlurMode::Recursive || mode == BlurMode::Box || mode == BlurMode::Pyramid) &&
+        border != BorderMode::Clamp) {
+        printf("Kernels: the recursive, box and pyramid modes only support the clamp border, falling back to clamp\n");
+        border = BorderMode::Clamp;
+    }
+    if (border != BorderMode::Clamp) {
+        const char* borders[] = {"clamp", "mirror", "wrap", "constant"};
+        printf("Kernels: %s border\n", borders[static_cast<int>(border)]);
+    }
+
+    if (mode == BlurMode::Pyramid) {
+        printf(
+            "Mode: pyramid, %d levels, sigma of %g at the coarsest level, %zux%zu work-groups\n",
+            pyramid.levels, pyramid.residualSigma, tileWidth, tileHeight
+        );
+        if (options.precision != Precision::Auto && options.precision != Precision::Float) {
+            printf("Kernels: the pyramid mode needs float precision, falling back to float\n");
+        }
+        if (options.specialize) {
+            printf("Kernels: specialized for a radius of %zu\n", radius);
+        } else {
+            printf("Kernels: generic\n");
+        }
+        free(tmpImage);
+        auto* imageOutput = blurPyramid(
+            app, imageInput, smoothKernel, pyramid.levels, tileWidth, tileHeight, options.specialize
+        );
+
+        auto outputFilename = writeImage(imageInput, imageOutput);
+        if (outputFilename.has_value()) printf("Blurred image written in '%s'\n", outputFilename->c_str());
+        OpenCL::release(app);
+        exit(outputFilename.has_value() ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    if (mode == BlurMode::Image) {
+        printf("Mode: image, %zux%zu work-groups\n", tileWidth, tileHeight);
+        if (options.precision != Precision::Auto && options.precision != Precision::Float) {
+            printf("Kernels: the image mode needs float precision, falling back to float\n");
+        }
+        if (options.specialize) {
+            printf("Kernels: specialized for a radius of %zu\n", radius);
+        } else {
+            printf("Kernels: generic\n");
+        }
+        free(tmpImage);
+        auto* imageOutput = blurImage(app, imageInput, smoothKernel, border, tileWidth, tileHeight, options.specialize);
+        stbi_image_free(imageInput.data);
+
+        auto outputFilename = writeImage(imageInput, imageOutput);
+        if (outputFilename.has_value()) printf("Blurred image written in '%s'\n", outputFilename->c_str());
+        free(imageOutput);
+        OpenCL::release(app);
+        exit(outputFilename.has_value() ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    std::string horizontalKernelName;
+    std::string verticalKernelName;
+    if (mode == BlurMode::Row) {
+        printf("Mode: row, one work-group per row/column\n");
+        horizontalKernelName = "gaussian_blur_h";
+        verticalKernelName = "gaussian_blur_v";
+    } else if (mode == BlurMode::Tiled) {
+        printf("Mode: tiled, %zux%zu work-groups\n", tileWidth, tileHeight);
+        horizontalKernelName = "gaussian_blur_tiled_h";
+        verticalKernelName = "gaussian_blur_tiled_v";
+    } else if (mode == BlurMode::Transposed) {
+        printf("Mode: transposed, %zux%zu work-groups\n", tileWidth, tileHeight);
+        horizontalKernelName = "gaussian_blur_tiled_h";
+        verticalKernelName = "gaussian_blur_transposed";
+    } else if (mode == BlurMode::Blocked) {
+        printf("Mode: blocked, %zu pixels per work-item, %zux%zu work-groups\n", blockSize, tileWidth, tileHeight);
+        horizontalKernelName = "gaussian_blur_blocked_h";
+        verticalKernelName = "gaussian_blur_blocked_v";
+    } else if (mode == BlurMode::Gray) {
+        printf("Mode: gray, 16 pixels per work-item, %zux%zu work-groups\n", tileWidth, tileHeight);
+        horizontalKernelName = "gaussian_blur_gray_h";
+        verticalKernelName = "gaussian_blur_gray_v";
+    } else if (mode == BlurMode::Recursive) {
+        printf("Mode: recursive, one work-item per row/column, %zu work-items per work-group\n", tileWidth);
+        horizontalKernelName = "gaussian_blur_recursive_h";
+        verticalKernelName = "gaussian_blur_recursive_v";
+    } else if (mode == BlurMode::Box) {
+        printf("Mode: box, 3 boxes per pass, one work-item per row/column, %zu work-items per work-group\n", tileWidth);
+        horizontalKernelName = "gaussian_blur_box_h";
+        verticalKernelName = "gaussian_blur_box_v";
+    } else if (mode == BlurMode::Subgroup) {
+        printf("Mode: subgroup, %zu work-items per row run, %zux%zu work-groups vertically\n",
+               subGroupWidth, tileWidth, tileHeight);
+        horizontalKernelName = "gaussian_blur_subgroup";
+        verticalKernelName = "gaussian_blur_tiled_v";
+    } else if (differenceMode) {
+        // a single launch blurs with both kernels in both directions
+        printf("Mode: %s, %zux%zu work-groups\n", mode == BlurMode::Dog ? "dog" : "log", tileWidth, tileHeight);
+        horizontalKernelName = "gaussian_difference";
+    } else {
+        // a single launch blurs in both directions
+        printf("Mode: fused, %zux%zu work-groups\n", tileWidth, tileHeight);
+        horizontalKernelName = "gaussian_blur_fused";
+    }
+    auto singleLaunch = mode == BlurMode::Fused || differenceMode;
+    // the difference kernels cache float pixels
+    auto cachePixelSize = differenceMode ? channels * sizeof(cl_float) : kernelImage.pixelSize;
+    BlurPass horizontalPass;
+    BlurPass verticalPass;
+    modePasses(
+        mode, width, height, cachePixelSize, tileWidth, tileHeight, radius, blockSize, subGroupWidth,
+        horizontalPass, verticalPass
+    );
+
+    // fixed point avoids the float conversion of every tap, which dominates on CPU devices
+    // half precision doubles the arithmetic throughput on devices with cl_khr_fp16
+    auto precision = options.precision;
+    auto halfFits = kernelImage.type == PixelType::UChar && OpenCL::supportsExtension(app, "cl_khr_fp16");
+    // the recursive filter feeds its results back and the running sums of the boxes accumulate,
+    // both need the precision of float
+    auto lineMode = mode == BlurMode::Recursive || mode == BlurMode::Box;
+    if (lineMode && precision != Precision::Auto && precision != Precision::Float) {
+        printf("Kernels: the recursive and box modes need float precision, falling back to float\n");
+    }
+    if (lineMode) precision = Precision::Float;
+    // the differences of the dog and log modes are small against the sums they are taken from
+    if (differenceMode && precision != Precision::Auto && precision != Precision::Float) {
+        printf("Kernels: the dog and log modes need float precision, falling back to float\n");
+    }
+    if (differenceMode) precision = Precision::Float;
+    if (precision == Precision::Auto) {
+        if (isCpu && options.specialize && imageInput.type != PixelType::Float) {
+            precision = Precision::Fixed;
+        } else if (halfFits && radius <= maxHalfPrecisionRadius) {
+            precision = Precision::Half;
+        } else {
+            precision = Precision::Float;
+        }
+    }
+    if (precision == Precision::Half && !halfFits) {
+        printf("Kernels: half precision needs 8-bit pixels without linear light or premultiplied alpha "
+               "and cl_khr_fp16, falling back to float\n");
+        precision = Precision::Float;
+    }
+    if (precision == Precision::Half) {
+        printf("Kernels: half precision\n");
+    }
+    std::optional<std::vector<cl_ushort>> weights;
+    if (precision == Precision::Fixed) {
+        if (!options.specialize || imageInput.type == PixelType::Float) {
+            printf("Error: Fixed point needs specialized kernels and integer pixels\n");
+            exit(EXIT_FAILURE);
+        }
+        weights = fixedPointWeights(smoothKernel);
+        if (!weights.has_value()) {
+            printf("Kernels: fixed point needs non-negative weights, falling back to float\n");
+        }
+    }
+    if (weights.has_value()) {
+        printf("Kernels: 1.15 fixed point weights\n");
+    }
+
+    // specialized variants are cached per configuration, the generic variant reads the runtime arguments
+    auto genericOptions = baseOptions(smoothKernel, kernelImage);
+    // the line modes pass their filter coefficients or box radii instead of the weights
+    std::vector<cl_float> lineArguments;
+    if (mode == BlurMode::Recursive) {
+        lineArguments = recursiveCoefficients(options.sigma);
+        genericOptions += " -DRECURSIVE";
+    }
+    auto radii = boxRadii(options.sigma, 3);
+    if (mode == BlurMode::Box) {
+        lineArguments.assign(radii.begin(), radii.end());
+        genericOptions += " -DBOX";
+    }
+    // both directions are entry points of the same program
+    auto kernelOptions = genericOptions;
+    // options of the weights of a smooth kernel, the levels of a scale space only differ in these
+    auto weightOptions = [&](
+        const SmoothKernel& kernel, const std::optional<std::vector<cl_ushort>>& kernelWeights
+    ) {
+        // the difference kernels read both of their kernels from the argument, their loops are specialized only
+        if (differenceMode && options.specialize) {
+            return genericOptions + " -DRADIUS=" + std::to_string(kernel.dimension / 2);
+        }
+        if (options.specialize) return specializationOptions(kernel, kernelImage, kernelWeights);
+        // the private windows of the blocked kernel are sized at compile time
+        if (mode == BlurMode::Blocked) return genericOptions + " -DRADIUS=" + std::to_string(kernel.dimension / 2);
+        return genericOptions;
+    };
+    if (options.specialize && mode == BlurMode::Recursive) {
+        printf("Kernels: specialized for a sigma of %g\n", options.sigma);
+        kernelOptions += recursiveSpecializationOptions(lineArguments);
+    } else if (options.specialize && mode == BlurMode::Box) {
+        printf("Kernels: specialized for box radii of %d, %d & %d\n", radii[0], radii[1], radii[2]);
+        kernelOptions += boxSpecializationOptions(radii);
+    } else if (options.specialize) {
+        printf("Kernels: specialized for a radius of %d\n", smoothKernel.dimension / 2);
+        kernelOptions = weightOptions(smoothKernel, weights);
+    } else {
+        printf("Kernels: generic\n");
+        if (!lineMode) kernelOptions = weightOptions(smoothKernel, weights);
+    }
+    // options shared by all weights
+    std::string featureOptions;
+    if (mode == BlurMode::Blocked) {
+        featureOptions += " -DBLOCK=" + std::to_string(blockSize);
+    }
+    if (precision == Precision::Half) {
+        featureOptions += " -DHALF_PRECISION";
+    }
+    featureOptions += borderOptions(border);
+    if (mode == BlurMode::Subgroup) {
+        featureOptions += " -DSUBGROUP";
+        featureOptions += subGroupStd;
+    }
+    if (images > 1) {
+        printf("Kernels: batch of %zu images\n", images);
+        featureOptions += " -DBATCH";
+    }
+    if (options.sharpenAmount > 0) {
+        printf("Kernels: unsharp mask with an amount of %g and a threshold of %g\n",
+               options.sharpenAmount, options.sharpenThreshold);
+        featureOptions += sharpenOptions(options.sharpenAmount, options.sharpenThreshold, imageInput);
+    }
+    if (linearLight) {
+        printf("Kernels: linear light, sRGB decoded to a 16-bit linear intermediate image\n");
+        featureOptions += linearLightOptions();
+    }
+    if (premultiply) {
+        printf("Kernels: premultiplied alpha, colors weighted by their alpha in a 16-bit intermediate image\n");
+        featureOptions += " -DPREMULTIPLY_ALPHA";
+    }
+    if (convertImage) {
+        featureOptions += imageInput.type == PixelType::UChar ? " -DIMAGE_TYPE=uchar" : " -DIMAGE_TYPE=ushort";
+    }
+    if (differenceMode) {
+        printf("Kernels: %s, %s\n",
+               mode == BlurMode::Dog ? "differences of Gaussians" : "Laplacians of Gaussians",
+               imageInput.type == PixelType::Float ? "signed" : "offset by half the range");
+        featureOptions += differenceOptions(mode == BlurMode::Log, imageInput);
+    }
+    kernelOptions += featureOptions;
+    if (smoothKernel.symmetric && !lineMode) {
+        printf("Kernels: folding the symmetric smooth kernel\n");
+    }
+
+    // the image object kernel blurs the same input first, the output of the faster variant is kept
+    void* benchmarkOutput = nullptr;
+    double imageSeconds = 0;
+    if (options.benchmark && imagesFit) {
+        benchmarkOutput = blurImage(
+            app, imageInput, smoothKernel, border, tileWidth, tileHeight, options.specialize, &imageSeconds
+        );
+    } else if (options.benchmark) {
+        printf("Benchmark: image objects are not supported, only the buffer kernels run\n");
+    }
+
+    // regions of interest are blurred one after another from their halo, the buffers fit the largest halo
+    std::vector<Region> halos;
+    auto bufferSize = options.rois.empty() ? batchSize : 0;
+    size_t roiPixels = 0;
+    size_t haloPixels = 0;
+    for (auto& roi: options.rois) {
+        auto halo = haloRegion(roi, radius, width, height, border);
+        halos.push_back(halo);
+        bufferSize = std::max(bufferSize, halo.width * halo.height * pixelSize);
+        roiPixels += roi.width * roi.height;
+        haloPixels += halo.width * halo.height;
+    }
+    if (!halos.empty()) {
+        printf("Regions: %zu regions of interest with %zu pixels, %zu pixels of %zu written to the device\n",
+               halos.size(), roiPixels, haloPixels, width * height);
+    }
+
+    // allocate buffers, the input becomes the output of the vertical pass
+    // the fused output of a scale space level is the input of the next one, the difference modes keep the input
+    std::function<void(void*)> freeInput = [](void* pointer) { stbi_image_free(pointer); };
+    if (images > 1) freeInput = [](void* pointer) { free(pointer); };
+    auto fusedOnce = (mode == BlurMode::Fused && levels == 1) || differenceMode;
     auto imageInputArg = OpenCL::addArgument(
-        app, "imageInput", 0, imageInput.data,
-        [](void* pointer) { stbi_image_free(pointer); },
-        imageInput.size, CL_MEM_READ_ONLY, true
+        app, "imageInput", 0, imageInput.data, freeInput,
+        bufferSize, fusedOnce ? CL_MEM_READ_ONLY : CL_MEM_READ_WRITE, halos.empty()
     );
+    // intermediate image of the two passes in the pixels of the kernels, or already the output when both passes
+    // are fused
+    auto tmpImageSize = singleLaunch ? bufferSize : bufferSize / pixelSize * kernelImage.pixelSize;
     auto tmpImageArg = OpenCL::addArgument(
         app, "imageOutput", 1, tmpImage,
         [](void* pointer) { free(pointer); },
-        imageInput.size, CL_MEM_READ_WRITE, false
-    );
-    OpenCL::addArgument(
-        app, "width", 2, &imageInput.width, std::nullopt,
-        sizeof(cl_int), CL_MEM_READ_ONLY, true
-    );
-    OpenCL::addArgument(
-        app, "height", 3, &imageInput.height, std::nullopt,
-        sizeof(cl_int), CL_MEM_READ_ONLY, true
-    );
-    OpenCL::addArgument(
-        app, "smoothKernel", 4, smoothKernel.data, std::nullopt,
-        smoothKernel.size, CL_MEM_READ_ONLY, true
+        tmpImageSize, fusedOnce ? CL_MEM_WRITE_ONLY : CL_MEM_READ_WRITE, false
     );
-    OpenCL::addArgument(
-        app, "smoothKernelDimension", 5, &smoothKernel.dimension, std::nullopt,
-        sizeof(cl_int), CL_MEM_READ_ONLY, true
-    );
-    auto horizontalArg = OpenCL::addArgument(
-        app, "horizontal", 6, &isHorizontal, std::nullopt,
-        sizeof(cl_bool), CL_MEM_READ_ONLY, true
-    );
-    auto pixelArg = OpenCL::addLocalArgument(app, "pixel", 7, width * channels * sizeof(cl_uchar));
+    // size of the image or of the halo of the region of interest being blurred
+    cl_int passWidth = imageInput.width;
+    cl_int passHeight = imageInput.height;
+    OpenCL::addScalarArgument(app, "width", 2, &passWidth, sizeof(cl_int));
+    OpenCL::addScalarArgument(app, "height", 3, &passHeight, sizeof(cl_int));
+    std::shared_ptr<OpenCL::Argument> smoothKernelArg;
+    if (lineMode) {
+        smoothKernelArg = OpenCL::addArgument(
+            app, "smoothKernel", 4, lineArguments.data(), std::nullopt,
+            lineArguments.size() * sizeof(cl_float), CL_MEM_READ_ONLY, true
+        );
+    } else {
+        smoothKernelArg = OpenCL::addArgument(
+            app, "smoothKernel", 4, smoothKernel.data, std::nullopt,
+            smoothKernel.size, CL_MEM_READ_ONLY, true
+        );
+    }
+    OpenCL::addScalarArgument(app, "smoothKernelDimension", 5, &smoothKernel.dimension, sizeof(cl_int));
+    std::shared_ptr<OpenCL::Argument> pixelArg;
+    if (lineMode) {
+        // causal results of the recursive filter or the results of the first two boxes, shared by both passes
+        auto scratchImages = mode == BlurMode::Box ? 2 : 1;
+        pixelArg = OpenCL::addArgument(
+            app, "scratch", 6, nullptr, std::nullopt,
+            scratchImages * width * height * channels * sizeof(cl_float), CL_MEM_READ_WRITE, false
+        );
+    } else {
+        pixelArg = OpenCL::addLocalArgument(app, "pixel", 6, horizontalPass.cacheSize);
+    }
 
 
     // read the kernel source
@@ -172,73 +1841,183 @@ int main(int argc, char** argv) {
     // build the program
     // create the given kernel
     // set the kernel arguments
-    OpenCL::createKernel(app, "kernel/gaussian_blur.cl", "gaussian_blur");
 
-    // check device capabilities
-    // check if image fits
-    OpenCL::checkDeviceCapabilities(app, [width, height, channels](
-        auto maxWorkGroupSize, auto maxWorkItemDimensions, auto* maxWorkItemSizes, auto maxLocalMemory
-    ) {
-        if (maxWorkItemDimensions < 2) return false;
-        if (maxWorkItemSizes[0] < width) return false;
-        if (maxWorkItemSizes[1] < height) return false;
-        auto maxCachingSize = std::max(width, height) * channels * sizeof(cl_uchar);
-        if (maxLocalMemory < maxCachingSize) return false;
-        return true;
-    });
+    // blurs the image, or the halo of a region of interest, of passWidth x passHeight pixels in the input buffer
+    // and returns the argument that holds the output
+    auto blurPasses = [&]() {
+        modePasses(
+            mode, passWidth, passHeight, cachePixelSize, tileWidth, tileHeight, radius, blockSize,
+            subGroupWidth, horizontalPass, verticalPass
+        );
+        // local memory pixel cache
+        if (!lineMode) {
+            OpenCL::removeArgument(app, pixelArg);
+            pixelArg = OpenCL::addLocalArgument(app, "pixel", 6, horizontalPass.cacheSize);
+        }
+        OpenCL::createKernel(app, "kernel/gaussian_blur.cl", horizontalKernelName, kernelOptions);
 
-    // create event for synchronization
-    cl_event horizontalEvent;
+        // execute the kernel
+        // blur horizontally
+        enqueuePass(app, horizontalPass, images);
+        if (singleLaunch) return tmpImageArg;
 
-    // execute the kernel
-    // blur horizontally
-    size_t globalWorkSize[2] = {width, height}; // https://stackoverflow.com/a/31379085
-    size_t localWorkSizeHorizontal[2] = {width, 1};
-    OpenCL::enqueueKernel(app, 2, globalWorkSize, localWorkSizeHorizontal, 0, nullptr, &horizontalEvent);
+        // prepare second pass, the host does not wait for the horizontal one
+        // swap buffers, the input is no longer needed and receives the output
+        OpenCL::swapArgumentIndices(app, imageInputArg, tmpImageArg);
+        // local memory pixel cache
+        if (!lineMode) {
+            OpenCL::removeArgument(app, pixelArg);
+            pixelArg = OpenCL::addLocalArgument(app, "pixel", 6, verticalPass.cacheSize);
+        }
+        // Switch to the vertical kernel & apply new arguments
+        OpenCL::createKernel(app, "kernel/gaussian_blur.cl", verticalKernelName, kernelOptions);
 
-    // wait for horizontal kernel to finish
-    OpenCL::waitForEvents(1, &horizontalEvent);
+        // execute the kernel
+        // blur vertically
+        enqueuePass(app, verticalPass, images);
+        return imageInputArg;
+    };
 
-    // prepare second pass
-    // change direction
-    OpenCL::removeArgument(app, horizontalArg);
-    isHorizontal = false;
-    OpenCL::addArgument(
-        app, "horizontal", 6, &isHorizontal, std::nullopt,
-        sizeof(cl_bool), CL_MEM_READ_ONLY, true
-    );
-    // swap & create buffers
-    OpenCL::removeArgument(app, imageInputArg);
-    OpenCL::changeArgumentIndex(app, tmpImageArg, 0);
-    auto* imageOutput = static_cast<cl_uchar*>(malloc(imageInput.size));
-    auto imageOutputArg = OpenCL::addArgument(
-        app, "imageOutput", 1, imageOutput,
-        [](void* pointer) { free(pointer); },
-        imageInput.size, CL_MEM_WRITE_ONLY, false
-    );
-    // local memory pixel cache
-    OpenCL::removeArgument(app, pixelArg);
-    OpenCL::addLocalArgument(app, "pixel", 7, height * channels * sizeof(cl_uchar));
-    // Apply new arguments
-    OpenCL::refreshKernelArguments(app);
+    // time of the passes of the whole image, compared to the image objects when benchmarking
+    double bufferSeconds = 0;
+    void* roiOutput = nullptr;
+    void* levelOutput = nullptr;
+    auto* imageOutput = static_cast<cl_uchar*>(imageInput.data);
+    if (levels > 1) {
+        // every level is read back into its own image while the next one blurs it further on the device
+        levelOutput = malloc(levels * imageInput.size);
+        imageOutput = static_cast<cl_uchar*>(levelOutput);
+        for (size_t i = 0; i < levels; ++i) {
+            // the smooth kernel dimension is read from the level's kernel whenever the arguments are set
+            smoothKernel = levelKernels[i];
+            radius = smoothKernel.dimension / 2;
+            if (i > 0) {
+                OpenCL::removeArgument(app, smoothKernelArg);
+                smoothKernelArg = OpenCL::addArgument(
+                    app, "smoothKernel", 4, smoothKernel.data, std::nullopt,
+                    smoothKernel.size, CL_MEM_READ_ONLY, true
+                );
+                // fixed point levels whose weights do not fit fall back to float
+                auto levelWeights = weights.has_value() ? fixedPointWeights(smoothKernel) : std::nullopt;
+                kernelOptions = weightOptions(smoothKernel, levelWeights) + featureOptions;
+                // the output of the previous level becomes the input
+                if (!differenceMode) OpenCL::swapArgumentIndices(app, imageInputArg, tmpImageArg);
+                if (mode == BlurMode::Fused) std::swap(imageInputArg, tmpImageArg);
+            }
+            if (mode == BlurMode::Dog) {
+                printf("Scales: difference %zu of the sigmas %g and %g with a radius of %zu\n",
+                       i, options.scales[i], options.scales[i + 1], radius);
+            } else if (mode == BlurMode::Log) {
+                printf("Scales: Laplacian %zu with a sigma of %g and a radius of %zu\n", i, options.scales[i], radius);
+            } else {
+                printf("Scales: level %zu with a sigma of %g, a residual sigma of %g and a radius of %zu\n",
+                       i, options.scales[i], residualSigmas[i], radius);
+            }
+            auto imageOutputArg = blurPasses();
+            OpenCL::readBuffer(app, imageOutputArg, imageOutput + i * imageInput.size, imageInput.size, CL_TRUE);
+        }
+    } else if (halos.empty()) {
+        if (benchmarkOutput != nullptr) {
+            // an untimed run builds and warms up both kernels, the input is written again for the timed run
+            blurPasses();
+            if (!singleLaunch) OpenCL::swapArgumentIndices(app, imageInputArg, tmpImageArg);
+            OpenCL::writeBuffer(app, imageInputArg, CL_TRUE);
+        }
+        auto bufferStart = std::chrono::steady_clock::now();
+        auto imageOutputArg = blurPasses();
+        OpenCL::finish(app);
+        bufferSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - bufferStart).count();
+        // read the device output buffer to the host output array
+        OpenCL::readBuffer(app, imageOutputArg, CL_TRUE);
+        if (imageOutputArg == tmpImageArg) imageOutput = tmpImage;
+    } else {
+        // pixels outside of the regions of interest are copied through,
+        // only the halo of every region is written to the device and only the region is read back
+        roiOutput = malloc(imageInput.size);
+        memcpy(roiOutput, imageInput.data, imageInput.size);
+        imageOutput = static_cast<cl_uchar*>(roiOutput);
+        auto imageRowPitch = width * pixelSize;
+        for (size_t i = 0; i < halos.size(); ++i) {
+            auto& roi = options.rois[i];
+            auto& halo = halos[i];
+            auto haloRowPitch = halo.width * pixelSize;
+            size_t haloBufferOrigin[3] = {0, 0, 0};
+            size_t haloImageOrigin[3] = {halo.x * pixelSize, halo.y, 0};
+            size_t haloSize[3] = {haloRowPitch, halo.height, 1};
+            OpenCL::writeBufferRect(
+                app, imageInputArg, haloBufferOrigin, haloImageOrigin, haloSize, haloRowPitch, imageRowPitch,
+                imageInput.data
+            );
 
-    // execute the kernel
-    // blur vertically
-    size_t localWorkSizeVertical[2] = {1, height};
-    OpenCL::enqueueKernel(app, 2, globalWorkSize, localWorkSizeVertical, 0, nullptr, nullptr);
+            passWidth = static_cast<cl_int>(halo.width);
+            passHeight = static_cast<cl_int>(halo.height);
+            auto imageOutputArg = blurPasses();
 
-    // read the device output buffer to the host output array
-    OpenCL::readBuffer(app, imageOutputArg, CL_TRUE);
+            size_t roiBufferOrigin[3] = {(roi.x - halo.x) * pixelSize, roi.y - halo.y, 0};
+            size_t roiImageOrigin[3] = {roi.x * pixelSize, roi.y, 0};
+            size_t roiSize[3] = {roi.width * pixelSize, roi.height, 1};
+            OpenCL::readBufferRect(
+                app, imageOutputArg, roiBufferOrigin, roiImageOrigin, roiSize, haloRowPitch, imageRowPitch,
+                roiOutput, CL_TRUE
+            );
+            // the next region starts from the input buffer again
+            if (mode != BlurMode::Fused) OpenCL::swapArgumentIndices(app, imageInputArg, tmpImageArg);
+        }
+    }
 
-    // output result to file
-    stbi_write_png(
-        "blurred.png", imageInput.width, imageInput.height,
-        channels, imageOutput, imageInput.width * channels
-    );
-    printf("Blurred image written in 'blurred.png'\n");
+    // .hdr files have no negative values, the signed float results of the dog and log modes are offset by the
+    // magnitude of the most negative one, the same for all outputs so they stay comparable
+    if (differenceMode && imageInput.type == PixelType::Float) {
+        auto* values = reinterpret_cast<cl_float*>(imageOutput);
+        auto count = levels * imageInput.size / sizeof(cl_float);
+        auto offset = -std::min(0.0f, *std::min_element(values, values + count));
+        for (size_t i = 0; i < count; ++i) values[i] += offset;
+        printf("Kernels: signed results offset by %g in the written .hdr images\n", offset);
+    }
+
+    void* output = imageOutput;
+    if (benchmarkOutput != nullptr) {
+        printf("Benchmark: image objects took %.3f ms, buffers %.3f ms\n", imageSeconds * 1e3, bufferSeconds * 1e3);
+        if (imageSeconds < bufferSeconds) {
+            printf("Benchmark: image objects are faster on this device, writing their output\n");
+            output = benchmarkOutput;
+        } else {
+            printf("Benchmark: buffers are faster on this device, writing their output\n");
+        }
+        recordBenchmark(deviceName, imageSeconds < bufferSeconds ? "image" : "buffers");
+        printf("Benchmark: recorded for %s in '%s'\n", deviceName.c_str(), benchmarkRecords().string().c_str());
+    }
+
+    // output result to file, in the precision of the input, the images of a batch or the levels of a scale space
+    // are numbered
+    auto outputs = std::max(images, levels);
+    auto written = true;
+    if (outputs == 1) {
+        auto outputFilename = writeImage(imageInput, output);
+        written = outputFilename.has_value();
+        if (written) printf("Blurred image written in '%s'\n", outputFilename->c_str());
+    } else {
+        // a failed output does not keep the following ones from being written
+        size_t failed = 0;
+        for (size_t i = 0; i < outputs; ++i) {
+            auto outputFilename = writeImage(
+                imageInput, static_cast<char*>(output) + i * imageInput.size, "blurred_" + std::to_string(i)
+            );
+            if (!outputFilename.has_value()) ++failed;
+        }
+        written = failed == 0;
+        if (written) {
+            printf("Blurred images written in 'blurred_0' to 'blurred_%zu'\n", outputs - 1);
+        } else {
+            printf("Error: %zu of %zu blurred images could not be written\n", failed, outputs);
+        }
+    }
+    free(benchmarkOutput);
+    free(roiOutput);
+    free(levelOutput);
 
     // release allocated resources
     OpenCL::release(app);
 
-    exit(EXIT_SUCCESS);
+    exit(written ? EXIT_SUCCESS : EXIT_FAILURE);
 }
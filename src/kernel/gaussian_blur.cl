@@ -1,52 +1,1424 @@
+// Pixels consist of -DCHANNELS=<1..4> interleaved components (default 3)
+// of -DPIXEL_TYPE=<uchar|ushort|float> (default uchar).
+// Specialized variants are built with -DRADIUS=<r> -DSMOOTH_KERNEL=<weights>,
+// which turns the kernel loops into compile-time loops that can be fully unrolled.
+// Without these options the runtime arguments are used instead.
+// -DBORDER=<BORDER_CLAMP|BORDER_MIRROR|BORDER_WRAP|BORDER_CONSTANT> selects the border mode (default clamp).
+// -DSUBGROUP adds the horizontal pass exchanging pixels through sub-group shuffles.
+// -DBATCH blurs same-sized images stored back to back, the third dimension of the launch selects the image.
+// -DSHARPEN_AMOUNT=<amount> -DSHARPEN_THRESHOLD=<threshold> turns the last pass into an unsharp mask.
+// -DSRGB_TO_LINEAR=<table> blurs 8-bit sRGB images in linear light, PIXEL_TYPE is then the linear intermediate type.
+// -DPREMULTIPLY_ALPHA blurs the colors of straight alpha images weighted by their alpha.
+// -DDIFFERENCE adds the difference of Gaussians kernel, with -DLAPLACIAN it computes the Laplacian of a Gaussian.
+#ifndef CHANNELS
+#define CHANNELS 3
+#endif
 
-__kernel void gaussian_blur(
-	__global const uchar *A,
-	__global uchar *B,
-	__constant int *width,
-	__constant int *height,
+#ifndef PIXEL_TYPE
+#define PIXEL_TYPE uchar
+#endif
+#define CONCAT(a, b) a ## b
+#define VECTOR_TYPE(type, n) CONCAT(type, n)
+#define PIXEL_TYPE4 VECTOR_TYPE(PIXEL_TYPE, 4)
+#define PIXEL_TYPE16 VECTOR_TYPE(PIXEL_TYPE, 16)
+#define CONVERT_PIXEL4 VECTOR_TYPE(convert_, PIXEL_TYPE4)
+#define CONVERT_PIXEL16 VECTOR_TYPE(convert_, PIXEL_TYPE16)
+
+#ifdef FIXED_POINT
+// Integer pixels only, the weights are baked in as 1.15 fixed point integers summing up to exactly 1 << 15.
+// Taps are accumulated as integers without float conversion and the sum is shifted back, rounded, at the end.
+#ifndef SMOOTH_KERNEL
+#error "Fixed point kernels need their weights baked in with -DSMOOTH_KERNEL"
+#endif
+#define WEIGHT_TYPE ushort
+#define ACCUMULATOR_TYPE uint
+#define SCALE_RESULT(sum) (((sum) + (1u << 14)) >> 15)
+#elif defined(HALF_PRECISION)
+// 8-bit pixels only, weights and sums are half, which is precise enough for the output of small kernels.
+// The blocked kernel accumulates half8 vectors, the other kernels scalar halfs.
+#pragma OPENCL EXTENSION cl_khr_fp16 : enable
+#define WEIGHT_TYPE half
+#define ACCUMULATOR_TYPE half
+#define SCALE_RESULT(sum) (sum)
+#else
+#define WEIGHT_TYPE float
+#define ACCUMULATOR_TYPE float
+#define SCALE_RESULT(sum) (sum)
+#endif
+#define ACCUMULATOR_TYPE4 VECTOR_TYPE(ACCUMULATOR_TYPE, 4)
+#define ACCUMULATOR_TYPE16 VECTOR_TYPE(ACCUMULATOR_TYPE, 16)
+#define CONVERT_ACCUMULATOR4 VECTOR_TYPE(convert_, ACCUMULATOR_TYPE4)
+#define CONVERT_ACCUMULATOR16 VECTOR_TYPE(convert_, ACCUMULATOR_TYPE16)
+
+#if CHANNELS == 4
+// RGBA pixels are naturally aligned, copy them with single vector accesses (32-bit for uchar)
+#define COPY_PIXEL(destination, source) \
+	*(__local PIXEL_TYPE4*)(destination) = *(__global const PIXEL_TYPE4*)(source)
+#define STORE_PIXEL(addressSpace, destination, color) \
+	*(addressSpace PIXEL_TYPE4*)(destination) = CONVERT_PIXEL4(SCALE_RESULT((ACCUMULATOR_TYPE4)((color)[0], (color)[1], (color)[2], (color)[3])))
+#else
+#define COPY_PIXEL(destination, source) \
+	for (int c = 0; c < CHANNELS; c++) (destination)[c] = (source)[c]
+#define STORE_PIXEL(addressSpace, destination, color) \
+	for (int c = 0; c < CHANNELS; c++) (destination)[c] = SCALE_RESULT((color)[c])
+#endif
+
+// Value of a sum as float, before the rounding of SCALE_RESULT
+#ifdef FIXED_POINT
+#define BLURRED_COMPONENT(sum) ((float)(sum) / (1 << 15))
+#else
+#define BLURRED_COMPONENT(sum) ((float)(sum))
+#endif
+
+#if defined(SRGB_TO_LINEAR) || defined(PREMULTIPLY_ALPHA)
+// The first pass converts the pixels it reads from the image, the last pass converts back what it writes into it.
+// The intermediate image and the caches hold 16-bit components of PIXEL_TYPE ushort, the image holds components of
+// -DIMAGE_TYPE=<uchar|ushort>. Only the row, tiled, transposed and fused kernels convert.
+#define IMAGE_MAX (sizeof(IMAGE_TYPE) == 1 ? 255 : 65535)
+#define CONVERT_IMAGE_COMPONENT VECTOR_TYPE(VECTOR_TYPE(convert_, IMAGE_TYPE), _sat_rte)
+
+// Alpha is stored linearly and straight, only the color components are converted
+#define IS_ALPHA(c) ((CHANNELS == 2 || CHANNELS == 4) && (c) == CHANNELS - 1)
+
+#ifdef SRGB_TO_LINEAR
+__constant ushort srgbToLinear[256] = {SRGB_TO_LINEAR};
+#endif
+
+#if defined(PREMULTIPLY_ALPHA) && CHANNELS != 2 && CHANNELS != 4
+#error "Premultiplied alpha needs an alpha channel"
+#endif
+
+// 16-bit intermediate value of component c of the image
+inline float decodeComponent(IMAGE_TYPE value, int c)
+{
+#ifdef SRGB_TO_LINEAR
+	if (!IS_ALPHA(c)) return srgbToLinear[value];
+#endif
+	return value * (65535 / IMAGE_MAX);
+}
+
+// Component c of the image of a 16-bit intermediate value
+inline IMAGE_TYPE encodeComponent(float value, int c)
+{
+	value /= 65535;
+#ifdef SRGB_TO_LINEAR
+	if (!IS_ALPHA(c)) value = value <= 0.0031308f ? 12.92f * value : 1.055f * powr(value, 1 / 2.4f) - 0.055f;
+#endif
+	return CONVERT_IMAGE_COMPONENT(value * IMAGE_MAX);
+}
+
+// Intermediate components of a pixel of the image, with -DPREMULTIPLY_ALPHA its colors are weighted by its alpha
+// so that transparent pixels do not bleed their color into their neighbours
+inline void decodePixel(__global const IMAGE_TYPE* pixel, float* components)
+{
+	for (int c = 0; c < CHANNELS; c++) components[c] = decodeComponent(pixel[c], c);
+#ifdef PREMULTIPLY_ALPHA
+	for (int c = 0; c < CHANNELS - 1; c++) components[c] *= components[CHANNELS - 1] / 65535;
+#endif
+}
+
+// Stores the blurred sums of a pixel into the image, with -DPREMULTIPLY_ALPHA its colors are divided by its alpha
+inline void encodePixel(__global IMAGE_TYPE* pixel, const ACCUMULATOR_TYPE* color)
+{
+	float components[CHANNELS];
+	for (int c = 0; c < CHANNELS; c++) components[c] = BLURRED_COMPONENT(color[c]);
+#ifdef PREMULTIPLY_ALPHA
+	float alpha = components[CHANNELS - 1];
+	for (int c = 0; c < CHANNELS - 1; c++) components[c] = alpha > 0 ? components[c] * 65535 / alpha : 0;
+#endif
+	for (int c = 0; c < CHANNELS; c++) pixel[c] = encodeComponent(components[c], c);
+}
+
+// Copies the pixel at component index of the source into the cache, converting it if the source is the image
+#define LOAD_PIXEL(destination, source, index, image) \
+	if (image) { \
+		float components[CHANNELS]; \
+		decodePixel((__global const IMAGE_TYPE*)(source) + (index), components); \
+		for (int c = 0; c < CHANNELS; c++) (destination)[c] = convert_ushort_rte(components[c]); \
+	} else { \
+		COPY_PIXEL(destination, (source) + (index)); \
+	}
+
+// Final store of a pass, the last pass converts its results into the image
+#define STORE_RESULT(destination, index, original, color, horizontal) \
+	if (horizontal) { \
+		STORE_PIXEL(__global, (destination) + (index), color); \
+	} else { \
+		encodePixel((__global IMAGE_TYPE*)(destination) + (index), color); \
+	}
+#else
+#define LOAD_PIXEL(destination, source, index, image) COPY_PIXEL(destination, (source) + (index))
+#endif
+
+#ifdef SHARPEN_AMOUNT
+// Unsharp mask: original + amount * (original - blurred) where the difference exceeds the threshold,
+// rounded and clamped to -DPIXEL_MAX=<max> for integer pixels. The blurred sum is used before truncation.
+inline PIXEL_TYPE sharpenComponent(PIXEL_TYPE original, ACCUMULATOR_TYPE sum)
+{
+	float difference = original - BLURRED_COMPONENT(sum);
+	float sharpened = fabs(difference) > SHARPEN_THRESHOLD ? original + SHARPEN_AMOUNT * difference : original;
+#ifdef PIXEL_MAX
+	return clamp(sharpened + 0.5f, 0.0f, PIXEL_MAX);
+#else
+	return fmax(sharpened, 0.0f);
+#endif
+}
+
+// Final store of a pass, the vertical pass sharpens the original pixel instead of storing the blurred one.
+// Both passes cost the memory traffic of a plain blur plus the read of the original pixel.
+#define STORE_RESULT(destination, index, original, color, horizontal) \
+	if (horizontal) { \
+		STORE_PIXEL(__global, (destination) + (index), color); \
+	} else { \
+		for (int c = 0; c < CHANNELS; c++) (destination)[(index) + c] = sharpenComponent((original)[c], (color)[c]); \
+	}
+#elif !defined(SRGB_TO_LINEAR) && !defined(PREMULTIPLY_ALPHA)
+#define STORE_RESULT(destination, index, original, color, horizontal) \
+	STORE_PIXEL(__global, (destination) + (index), color)
+#endif
+
+#ifdef RADIUS
+#define SMOOTH_KERNEL_DIMENSION (2 * RADIUS + 1)
+#else
+#define SMOOTH_KERNEL_DIMENSION (smoothKernelDimension)
+#define RADIUS (SMOOTH_KERNEL_DIMENSION / 2)
+#endif
+
+// Taps outside of the image read the nearest edge pixel (clamp), the image mirrored at its edges
+// with the edge pixel repeated (mirror), the image repeated periodically (wrap) or transparent black (constant)
+#define BORDER_CLAMP 0
+#define BORDER_MIRROR 1
+#define BORDER_WRAP 2
+#define BORDER_CONSTANT 3
+#ifndef BORDER
+#define BORDER BORDER_CLAMP
+#endif
+
+// Index of the pixel read by a tap at index i of a row or column of n pixels, -1 for the constant border
+inline int borderIndex(int i, int n)
+{
+#if BORDER == BORDER_MIRROR
+	if (i >= 0 && i < n) return i;
+	int period = 2 * n;
+	int mirrored = (i % period + period) % period;
+	return mirrored < n ? mirrored : period - 1 - mirrored;
+#elif BORDER == BORDER_WRAP
+	if (i >= 0 && i < n) return i;
+	return (i % n + n) % n;
+#elif BORDER == BORDER_CONSTANT
+	return i >= 0 && i < n ? i : -1;
+#else
+	return clamp(i, 0, n - 1);
+#endif
+}
+
+#ifdef SMOOTH_KERNEL
+__constant WEIGHT_TYPE specializedSmoothKernel[SMOOTH_KERNEL_DIMENSION] = {SMOOTH_KERNEL};
+#define SMOOTH_KERNEL_VALUE(i) specializedSmoothKernel[i]
+#else
+#define SMOOTH_KERNEL_VALUE(i) ((WEIGHT_TYPE)smoothKernel[i])
+#endif
+
+#if CHANNELS == 4
+// Cached RGBA pixel as an accumulator vector
+#define LOAD_TAP4(pixel) CONVERT_ACCUMULATOR4(vload4(0, pixel))
+#endif
+
+// Weighted sum of the taps around center, neighbouring taps are step components apart
+inline void convolve(
+	__local const PIXEL_TYPE* center,
+	int step,
+	__constant float *smoothKernel,
+	int smoothKernelDimension,
+	ACCUMULATOR_TYPE* color
+)
+{
+#if CHANNELS == 4
+	// RGBA taps are accumulated as 4-component vectors
+	ACCUMULATOR_TYPE4 sum = 0;
+#ifdef SYMMETRIC
+	#pragma unroll
+	for (int i = 0; i < RADIUS; i++) {
+		int offset = (RADIUS - i) * step;
+		ACCUMULATOR_TYPE kernelValue = SMOOTH_KERNEL_VALUE(i);
+		sum += (LOAD_TAP4(center - offset) + LOAD_TAP4(center + offset)) * kernelValue;
+	}
+	sum += LOAD_TAP4(center) * (ACCUMULATOR_TYPE)SMOOTH_KERNEL_VALUE(RADIUS);
+#else
+	#pragma unroll
+	for (int i = 0; i < SMOOTH_KERNEL_DIMENSION; i++) {
+		sum += LOAD_TAP4(center + (i - RADIUS) * step) * (ACCUMULATOR_TYPE)SMOOTH_KERNEL_VALUE(i);
+	}
+#endif
+	vstore4(sum, 0, color);
+#elif defined(SYMMETRIC)
+	// Mirrored taps share their weight, add the pixel pair first and multiply once
+	#pragma unroll
+	for (int c = 0; c < CHANNELS; c++) color[c] = 0;
+	#pragma unroll
+	for (int i = 0; i < RADIUS; i++) {
+		int offset = (RADIUS - i) * step;
+		WEIGHT_TYPE kernelValue = SMOOTH_KERNEL_VALUE(i);
+		#pragma unroll
+		for (int c = 0; c < CHANNELS; c++) color[c] += (center[c - offset] + center[c + offset]) * kernelValue;
+	}
+	WEIGHT_TYPE centerValue = SMOOTH_KERNEL_VALUE(RADIUS);
+	#pragma unroll
+	for (int c = 0; c < CHANNELS; c++) color[c] += center[c] * centerValue;
+#else
+	#pragma unroll
+	for (int c = 0; c < CHANNELS; c++) color[c] = 0;
+	#pragma unroll
+	for (int i = 0; i < SMOOTH_KERNEL_DIMENSION; i++) {
+		int offset = (i - RADIUS) * step;
+		WEIGHT_TYPE kernelValue = SMOOTH_KERNEL_VALUE(i);
+		#pragma unroll
+		for (int c = 0; c < CHANNELS; c++) color[c] += center[offset + c] * kernelValue;
+	}
+#endif
+}
+
+// Weighted sum of the taps around index center of a cached row or column of n pixels,
+// taps outside of it are read according to the border mode
+inline void convolveBorder(
+	__local const PIXEL_TYPE* line,
+	int center,
+	int n,
 	__constant float *smoothKernel,
-	__constant int *smoothKernelDimension,
-	__constant bool *horizontal,
-	__local uchar* pixel
+	int smoothKernelDimension,
+	ACCUMULATOR_TYPE* color
+)
+{
+#if CHANNELS == 4
+	// Pixel at index k, which is -1 outside of a constant border
+	#define BORDER_TAP4(k) (BORDER == BORDER_CONSTANT && (k) < 0 ? (ACCUMULATOR_TYPE4)0 : LOAD_TAP4(line + 4 * (k)))
+	ACCUMULATOR_TYPE4 sum = 0;
+#ifdef SYMMETRIC
+	#pragma unroll
+	for (int i = 0; i < RADIUS; i++) {
+		int left = borderIndex(center - (RADIUS - i), n);
+		int right = borderIndex(center + (RADIUS - i), n);
+		ACCUMULATOR_TYPE kernelValue = SMOOTH_KERNEL_VALUE(i);
+		sum += (BORDER_TAP4(left) + BORDER_TAP4(right)) * kernelValue;
+	}
+	sum += LOAD_TAP4(line + 4 * center) * (ACCUMULATOR_TYPE)SMOOTH_KERNEL_VALUE(RADIUS);
+#else
+	#pragma unroll
+	for (int i = 0; i < SMOOTH_KERNEL_DIMENSION; i++) {
+		int k = borderIndex(center + i - RADIUS, n);
+		sum += BORDER_TAP4(k) * (ACCUMULATOR_TYPE)SMOOTH_KERNEL_VALUE(i);
+	}
+#endif
+	vstore4(sum, 0, color);
+	#undef BORDER_TAP4
+#else
+	// Component c of the pixel at index k, which is -1 outside of a constant border
+	#define BORDER_TAP(k, c) (BORDER == BORDER_CONSTANT && (k) < 0 ? 0 : line[CHANNELS * (k) + (c)])
+	#pragma unroll
+	for (int c = 0; c < CHANNELS; c++) color[c] = 0;
+#ifdef SYMMETRIC
+	// Mirrored taps share their weight, add the pixel pair first and multiply once
+	#pragma unroll
+	for (int i = 0; i < RADIUS; i++) {
+		int left = borderIndex(center - (RADIUS - i), n);
+		int right = borderIndex(center + (RADIUS - i), n);
+		WEIGHT_TYPE kernelValue = SMOOTH_KERNEL_VALUE(i);
+		#pragma unroll
+		for (int c = 0; c < CHANNELS; c++) color[c] += (BORDER_TAP(left, c) + BORDER_TAP(right, c)) * kernelValue;
+	}
+	WEIGHT_TYPE centerValue = SMOOTH_KERNEL_VALUE(RADIUS);
+	#pragma unroll
+	for (int c = 0; c < CHANNELS; c++) color[c] += line[CHANNELS * center + c] * centerValue;
+#else
+	#pragma unroll
+	for (int i = 0; i < SMOOTH_KERNEL_DIMENSION; i++) {
+		int k = borderIndex(center + i - RADIUS, n);
+		WEIGHT_TYPE kernelValue = SMOOTH_KERNEL_VALUE(i);
+		#pragma unroll
+		for (int c = 0; c < CHANNELS; c++) color[c] += BORDER_TAP(k, c) * kernelValue;
+	}
+#endif
+	#undef BORDER_TAP
+#endif
+}
+
+// Copies the pixel at (x, y) into the cache, coordinates outside of the image are read according to the border mode.
+// image is set if A is the image read by the first pass rather than the intermediate image.
+inline void loadBorderPixel(
+	__local PIXEL_TYPE* destination,
+	__global const PIXEL_TYPE* A,
+	int x,
+	int y,
+	int width,
+	int height,
+	bool image
+)
+{
+	int sourceX = borderIndex(x, width);
+	int sourceY = borderIndex(y, height);
+#if BORDER == BORDER_CONSTANT
+	if (sourceX < 0 || sourceY < 0) {
+		for (int c = 0; c < CHANNELS; c++) destination[c] = 0;
+		return;
+	}
+#endif
+	LOAD_PIXEL(destination, A, CHANNELS * (sourceY * width + sourceX), image);
+}
+
+
+#ifdef BATCH
+// First pixel of the image of this work-item within a batch
+#define BATCH_IMAGE(pointer) ((pointer) + (size_t)CHANNELS * width * height * get_global_id(2))
+#else
+#define BATCH_IMAGE(pointer) (pointer)
+#endif
+
+// Exports the inline body of a separable pass as the entry points name_h and name_v,
+// the direction is a literal in each of them so the compiler drops the branches of the other direction
+#define DIRECTIONAL_KERNELS(name, body, SourceType, DestinationType, ScratchType) \
+	__kernel void name##_h(SourceType A, DestinationType B, int width, int height, \
+		__constant float *smoothKernel, int smoothKernelDimension, ScratchType scratch) \
+	{ \
+		body(BATCH_IMAGE(A), BATCH_IMAGE(B), width, height, smoothKernel, smoothKernelDimension, scratch, true); \
+	} \
+	__kernel void name##_v(SourceType A, DestinationType B, int width, int height, \
+		__constant float *smoothKernel, int smoothKernelDimension, ScratchType scratch) \
+	{ \
+		body(BATCH_IMAGE(A), BATCH_IMAGE(B), width, height, smoothKernel, smoothKernelDimension, scratch, false); \
+	}
+
+
+inline void gaussianBlur(
+	__global const PIXEL_TYPE *A,
+	__global PIXEL_TYPE *B,
+	int width,
+	int height,
+	__constant float *smoothKernel,
+	int smoothKernelDimension,
+	__local PIXEL_TYPE* pixel,
+	bool horizontal
 )
 {
 	size_t x = get_global_id(0);
 	size_t y = get_global_id(1);
-	size_t channels = 3;
-	size_t index = channels * (y * (*width) + x);
+	size_t index = CHANNELS * (y * width + x);
 
 	size_t localX = get_local_id(0);
 	size_t localY = get_local_id(1);
-	size_t localXY = *horizontal ? localX : localY;
-	size_t localIndex = channels * (*horizontal ? localX : localY);
-	size_t localMax = (*horizontal ? *width : *height)-1;
+	size_t localXY = horizontal ? localX : localY;
+	size_t localIndex = CHANNELS * localXY;
+	int size = horizontal ? width : height;
 
-	float red = 0;
-	float green = 0;
-	float blue = 0;
+	ACCUMULATOR_TYPE color[CHANNELS];
 
 	// Minimize access of source pixel values
-	pixel[localIndex] = A[index];
-	pixel[localIndex + 1] = A[index + 1];
-	pixel[localIndex + 2] = A[index + 2];
+	LOAD_PIXEL(pixel + localIndex, A, index, horizontal);
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// Apply gauss kernel, only the work-items within a radius of the border pay for the border handling
+	if ((int)localXY >= RADIUS && (int)localXY + RADIUS < size) {
+		convolve(pixel + localIndex, CHANNELS, smoothKernel, smoothKernelDimension, color);
+	} else {
+		convolveBorder(pixel, localXY, size, smoothKernel, smoothKernelDimension, color);
+	}
+
+	// Write results for each color component
+	// CHANNELS consecutive color components represent one pixel
+	// The vertical pass writes back into the input buffer, which still holds the original pixel
+	STORE_RESULT(B, index, B + index, color, horizontal);
+}
+DIRECTIONAL_KERNELS(gaussian_blur, gaussianBlur, __global const PIXEL_TYPE*, __global PIXEL_TYPE*, __local PIXEL_TYPE*)
+
+inline void gaussianBlurTiled(
+	__global const PIXEL_TYPE *A,
+	__global PIXEL_TYPE *B,
+	int width,
+	int height,
+	__constant float *smoothKernel,
+	int smoothKernelDimension,
+	__local PIXEL_TYPE* tile,
+	bool horizontal
+)
+{
+	int x = get_global_id(0);
+	int y = get_global_id(1);
+	int radius = RADIUS;
+
+	int localX = get_local_id(0);
+	int localY = get_local_id(1);
+	int tileWidth = get_local_size(0);
+	int tileHeight = get_local_size(1);
+
+	// Halo is only needed along the blur direction
+	int haloX = horizontal ? radius : 0;
+	int haloY = horizontal ? 0 : radius;
+	int cacheWidth = tileWidth + 2 * haloX;
+	int cacheHeight = tileHeight + 2 * haloY;
+	int originX = get_group_id(0) * tileWidth - haloX;
+	int originY = get_group_id(1) * tileHeight - haloY;
+
+	// Load tile and halo cooperatively, every work-item fetches every n-th pixel
+	// Only tiles whose halo reaches beyond the image pay for the border handling
+	bool interior = originX >= 0 && originY >= 0 && originX + cacheWidth <= width && originY + cacheHeight <= height;
+	if (interior) {
+		for (int i = localY * tileWidth + localX; i < cacheWidth * cacheHeight; i += tileWidth * tileHeight) {
+			int sourceIndex = CHANNELS * ((originY + i / cacheWidth) * width + originX + i % cacheWidth);
+			LOAD_PIXEL(tile + CHANNELS * i, A, sourceIndex, horizontal);
+		}
+	} else {
+		for (int i = localY * tileWidth + localX; i < cacheWidth * cacheHeight; i += tileWidth * tileHeight) {
+			loadBorderPixel(
+				tile + CHANNELS * i, A, originX + i % cacheWidth, originY + i / cacheWidth, width, height, horizontal
+			);
+		}
+	}
 	barrier(CLK_LOCAL_MEM_FENCE);
 
+	// Global work size is rounded up to whole tiles, the surplus work-items only help loading
+	if (x >= width || y >= height) return;
+
 	// Apply gauss kernel
-	for (int i = 0; i < (*smoothKernelDimension); i++) {
-		int k = localXY + (i - ((*smoothKernelDimension)/2));
+	ACCUMULATOR_TYPE color[CHANNELS];
+	int centerIndex = CHANNELS * ((localY + haloY) * cacheWidth + localX + haloX);
+	int step = CHANNELS * (horizontal ? 1 : cacheWidth);
+	convolve(tile + centerIndex, step, smoothKernel, smoothKernelDimension, color);
+
+	// Write results for each color component
+	size_t index = CHANNELS * (y * width + x);
+	STORE_RESULT(B, index, B + index, color, horizontal);
+}
+DIRECTIONAL_KERNELS(gaussian_blur_tiled, gaussianBlurTiled, __global const PIXEL_TYPE*, __global PIXEL_TYPE*, __local PIXEL_TYPE*)
+
+// Vertical pass only, the tile is loaded row by row and stored transposed so that
+// each column, and therefore the taps of each work-item, are consecutive in local memory
+__kernel void gaussian_blur_transposed(
+	__global const PIXEL_TYPE *A,
+	__global PIXEL_TYPE *B,
+	int width,
+	int height,
+	__constant float *smoothKernel,
+	int smoothKernelDimension,
+	__local PIXEL_TYPE* tile
+)
+{
+#ifdef BATCH
+	A = BATCH_IMAGE(A);
+	B = BATCH_IMAGE(B);
+#endif
+	int x = get_global_id(0);
+	int y = get_global_id(1);
+	int radius = RADIUS;
+
+	int localX = get_local_id(0);
+	int localY = get_local_id(1);
+	int tileWidth = get_local_size(0);
+	int tileHeight = get_local_size(1);
+
+	// An odd pitch lets neighbouring columns start in different local memory banks
+	int cacheHeight = tileHeight + 2 * radius;
+	int cachePitch = cacheHeight | 1;
+	int originX = get_group_id(0) * tileWidth;
+	int originY = get_group_id(1) * tileHeight - radius;
+
+	// Neighbouring work-items read neighbouring pixels of a row (coalesced) and write them into columns
+	// Only tiles whose halo reaches beyond the image pay for the border handling,
+	// columns beyond the image are cached as its last column but never used
+	bool interior = originY >= 0 && originX + tileWidth <= width && originY + cacheHeight <= height;
+	for (int i = localY * tileWidth + localX; i < tileWidth * cacheHeight; i += tileWidth * tileHeight) {
+		int cacheX = i % tileWidth;
+		int cacheY = i / tileWidth;
+		int cacheIndex = CHANNELS * (cacheX * cachePitch + cacheY);
+		if (interior) {
+			COPY_PIXEL(tile + cacheIndex, A + CHANNELS * ((originY + cacheY) * width + originX + cacheX));
+		} else {
+			loadBorderPixel(
+				tile + cacheIndex, A, min(originX + cacheX, width - 1), originY + cacheY, width, height, false
+			);
+		}
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// Global work size is rounded up to whole tiles, the surplus work-items only help loading
+	if (x >= width || y >= height) return;
+
+	// Apply gauss kernel along the cached column
+	ACCUMULATOR_TYPE color[CHANNELS];
+	int centerIndex = CHANNELS * (localX * cachePitch + localY + radius);
+	convolve(tile + centerIndex, CHANNELS, smoothKernel, smoothKernelDimension, color);
+
+	// Write results row-wise for each color component
+	size_t index = CHANNELS * (y * width + x);
+	STORE_RESULT(B, index, B + index, color, false);
+}
+
+// Both passes in a single launch, the horizontally blurred rows of the tile and its vertical halo
+// only live in local memory and never travel through global memory
+__kernel void gaussian_blur_fused(
+	__global const PIXEL_TYPE *A,
+	__global PIXEL_TYPE *B,
+	int width,
+	int height,
+	__constant float *smoothKernel,
+	int smoothKernelDimension,
+	__local PIXEL_TYPE* tile
+)
+{
+#ifdef BATCH
+	A = BATCH_IMAGE(A);
+	B = BATCH_IMAGE(B);
+#endif
+	int x = get_global_id(0);
+	int y = get_global_id(1);
+	int radius = RADIUS;
+
+	int localX = get_local_id(0);
+	int localY = get_local_id(1);
+	int tileWidth = get_local_size(0);
+	int tileHeight = get_local_size(1);
+
+	// Source pixels of the tile plus halo in both directions, followed by the horizontally blurred rows
+	int cacheWidth = tileWidth + 2 * radius;
+	int cacheHeight = tileHeight + 2 * radius;
+	__local PIXEL_TYPE* source = tile;
+	__local PIXEL_TYPE* blurred = tile + CHANNELS * cacheWidth * cacheHeight;
+	int originX = get_group_id(0) * tileWidth - radius;
+	int originY = get_group_id(1) * tileHeight - radius;
+
+	// Load tile and halo cooperatively, every work-item fetches every n-th pixel
+	// Only tiles whose halo reaches beyond the image pay for the border handling
+	bool interior = originX >= 0 && originY >= 0 && originX + cacheWidth <= width && originY + cacheHeight <= height;
+	if (interior) {
+		for (int i = localY * tileWidth + localX; i < cacheWidth * cacheHeight; i += tileWidth * tileHeight) {
+			int sourceIndex = CHANNELS * ((originY + i / cacheWidth) * width + originX + i % cacheWidth);
+			LOAD_PIXEL(source + CHANNELS * i, A, sourceIndex, true);
+		}
+	} else {
+		for (int i = localY * tileWidth + localX; i < cacheWidth * cacheHeight; i += tileWidth * tileHeight) {
+			loadBorderPixel(
+				source + CHANNELS * i, A, originX + i % cacheWidth, originY + i / cacheWidth, width, height, true
+			);
+		}
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// Blur horizontally, including the rows of the vertical halo
+	for (int row = localY; row < cacheHeight; row += tileHeight) {
+		ACCUMULATOR_TYPE color[CHANNELS];
+		int centerIndex = CHANNELS * (row * cacheWidth + localX + radius);
+		convolve(source + centerIndex, CHANNELS, smoothKernel, smoothKernelDimension, color);
+
+		int blurredIndex = CHANNELS * (row * tileWidth + localX);
+		STORE_PIXEL(__local, blurred + blurredIndex, color);
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// Global work size is rounded up to whole tiles, the surplus work-items only help loading
+	if (x >= width || y >= height) return;
+
+	// Blur vertically from local memory straight into the output
+	ACCUMULATOR_TYPE color[CHANNELS];
+	int centerIndex = CHANNELS * ((localY + radius) * tileWidth + localX);
+	convolve(blurred + centerIndex, CHANNELS * tileWidth, smoothKernel, smoothKernelDimension, color);
+
+	// Write results for each color component, the original pixel is still cached
+	size_t index = CHANNELS * (y * width + x);
+	STORE_RESULT(B, index, source + CHANNELS * ((localY + radius) * cacheWidth + localX + radius), color, false);
+}
+
+#ifdef DIFFERENCE
+// The difference kernel reads its two smooth kernels from the argument, -DRADIUS only sizes its loops
+#ifdef SMOOTH_KERNEL
+#error "The difference kernel reads its weights from the smoothKernel argument"
+#endif
+
+// Weighted sum of the taps around center of a float cache, neighbouring taps are step components apart
+inline void convolveCached(
+	__local const float* center,
+	int step,
+	__constant float* weights,
+	int smoothKernelDimension,
+	float* color
+)
+{
+	#pragma unroll
+	for (int c = 0; c < CHANNELS; c++) color[c] = 0;
+	#pragma unroll
+	for (int i = 0; i < SMOOTH_KERNEL_DIMENSION; i++) {
+		int offset = (i - RADIUS) * step;
+		float weight = weights[i];
+		#pragma unroll
+		for (int c = 0; c < CHANNELS; c++) color[c] += center[offset + c] * weight;
+	}
+}
+
+// Difference of two Gaussians, or with -DLAPLACIAN the Laplacian of a Gaussian G''(x) G(y) + G(x) G''(y),
+// in a single launch like the fused kernel. smoothKernel holds two kernels of smoothKernelDimension weights back to
+// back, the Gaussians or the Gaussian and its second derivative. Both horizontal sums are taken from the same cached
+// tile, the tile and both horizontally blurred rows are float. Results are signed, integer pixels are offset by
+// -DDIFFERENCE_OFFSET=<offset> and clamped, float pixels store the signed difference.
+__kernel void gaussian_difference(
+	__global const PIXEL_TYPE *A,
+	__global PIXEL_TYPE *B,
+	int width,
+	int height,
+	__constant float *smoothKernel,
+	int smoothKernelDimension,
+	__local float* tile
+)
+{
+	int x = get_global_id(0);
+	int y = get_global_id(1);
+	int radius = RADIUS;
+
+	int localX = get_local_id(0);
+	int localY = get_local_id(1);
+	int tileWidth = get_local_size(0);
+	int tileHeight = get_local_size(1);
+
+	// Source pixels of the tile plus halo in both directions, followed by the rows blurred with either kernel
+	int cacheWidth = tileWidth + 2 * radius;
+	int cacheHeight = tileHeight + 2 * radius;
+	__local float* source = tile;
+	__local float* firstBlurred = source + CHANNELS * cacheWidth * cacheHeight;
+	__local float* secondBlurred = firstBlurred + CHANNELS * tileWidth * cacheHeight;
+	int originX = get_group_id(0) * tileWidth - radius;
+	int originY = get_group_id(1) * tileHeight - radius;
+
+	// Load tile and halo cooperatively, every work-item fetches every n-th pixel
+	for (int i = localY * tileWidth + localX; i < cacheWidth * cacheHeight; i += tileWidth * tileHeight) {
+		int sourceX = borderIndex(originX + i % cacheWidth, width);
+		int sourceY = borderIndex(originY + i / cacheWidth, height);
+		for (int c = 0; c < CHANNELS; c++) {
+			source[CHANNELS * i + c] = sourceX < 0 || sourceY < 0 ? 0 : A[CHANNELS * (sourceY * width + sourceX) + c];
+		}
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// Blur horizontally with both kernels, including the rows of the vertical halo
+	__constant float* firstKernel = smoothKernel;
+	__constant float* secondKernel = smoothKernel + SMOOTH_KERNEL_DIMENSION;
+	for (int row = localY; row < cacheHeight; row += tileHeight) {
+		float color[CHANNELS];
+		int centerIndex = CHANNELS * (row * cacheWidth + localX + radius);
+		int blurredIndex = CHANNELS * (row * tileWidth + localX);
+		convolveCached(source + centerIndex, CHANNELS, firstKernel, smoothKernelDimension, color);
+		for (int c = 0; c < CHANNELS; c++) firstBlurred[blurredIndex + c] = color[c];
+		convolveCached(source + centerIndex, CHANNELS, secondKernel, smoothKernelDimension, color);
+		for (int c = 0; c < CHANNELS; c++) secondBlurred[blurredIndex + c] = color[c];
+	}
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	// Global work size is rounded up to whole tiles, the surplus work-items only help loading
+	if (x >= width || y >= height) return;
+
+	// Blur vertically, the Laplacian crosses the kernels
+	float firstColor[CHANNELS];
+	float secondColor[CHANNELS];
+	int centerIndex = CHANNELS * ((localY + radius) * tileWidth + localX);
+	int step = CHANNELS * tileWidth;
+#ifdef LAPLACIAN
+	convolveCached(firstBlurred + centerIndex, step, secondKernel, smoothKernelDimension, firstColor);
+	convolveCached(secondBlurred + centerIndex, step, firstKernel, smoothKernelDimension, secondColor);
+#else
+	convolveCached(firstBlurred + centerIndex, step, firstKernel, smoothKernelDimension, firstColor);
+	convolveCached(secondBlurred + centerIndex, step, secondKernel, smoothKernelDimension, secondColor);
+#endif
+
+	// Write the signed results for each color component
+	size_t index = CHANNELS * (y * width + x);
+	for (int c = 0; c < CHANNELS; c++) {
+#ifdef LAPLACIAN
+		float difference = firstColor[c] + secondColor[c];
+#else
+		float difference = firstColor[c] - secondColor[c];
+#endif
+#ifdef DIFFERENCE_OFFSET
+		B[index + c] = VECTOR_TYPE(VECTOR_TYPE(convert_, PIXEL_TYPE), _sat_rte)(difference + DIFFERENCE_OFFSET);
+#else
+		B[index + c] = difference;
+#endif
+	}
+}
+#endif
+
+#ifdef BLOCK
+// The blocked kernel is only built with -DBLOCK=<n>, its private windows are sized at compile time
+#ifndef RADIUS
+#error "The blocked kernel needs -DRADIUS"
+#endif
+
+#define BLOCK_SIZE (BLOCK * CHANNELS)
+#define WINDOW_SIZE ((BLOCK + 2 * RADIUS) * CHANNELS)
+
+#if defined(HALF_PRECISION) && BLOCK_SIZE % 8 == 0
+// Half sums of the block are accumulated as half8 vectors of 8 consecutive components,
+// so every tap is a single vector multiply-add on devices with packed half arithmetic
+#define HALF8_BLOCK
+#define BLOCK_VECTORS (BLOCK_SIZE / 8)
+#define ACCUMULATE_TAP(source, weight) \
+	for (int v = 0; v < BLOCK_VECTORS; v++) colors[v] += convert_half8(vload8(v, source)) * (weight)
+#define ACCUMULATE_TAP_PAIR(source, mirrored, weight) \
+	for (int v = 0; v < BLOCK_VECTORS; v++) \
+		colors[v] += (convert_half8(vload8(v, source)) + convert_half8(vload8(v, mirrored))) * (weight)
+#else
+#define ACCUMULATE_TAP(source, weight) \
+	for (int j = 0; j < BLOCK_SIZE; j++) color[j] += (source)[j] * (weight)
+#define ACCUMULATE_TAP_PAIR(source, mirrored, weight) \
+	for (int j = 0; j < BLOCK_SIZE; j++) color[j] += ((source)[j] + (mirrored)[j]) * (weight)
+#endif
+
+// Copy count consecutive components, 16 at a time with vector loads & stores
+inline void loadComponents(__global const PIXEL_TYPE* source, PIXEL_TYPE* destination, int count)
+{
+	int i = 0;
+	for (; i + 16 <= count; i += 16) vstore16(vload16(0, source + i), 0, destination + i);
+	for (; i < count; i++) destination[i] = source[i];
+}
+
+inline void storeComponents(const PIXEL_TYPE* source, __global PIXEL_TYPE* destination, int count)
+{
+	int i = 0;
+	for (; i + 16 <= count; i += 16) vstore16(vload16(0, source + i), 0, destination + i);
+	for (; i < count; i++) destination[i] = source[i];
+}
+
+// Every work-item blurs BLOCK consecutive pixels of a row. Horizontally from a sliding window of the row
+// kept in registers, vertically from BLOCK wide rows of every tap, so neighbouring pixels share their loads
+inline void gaussianBlurBlocked(
+	__global const PIXEL_TYPE *A,
+	__global PIXEL_TYPE *B,
+	int width,
+	int height,
+	__constant float *smoothKernel,
+	int smoothKernelDimension,
+	__local PIXEL_TYPE* tile, // unused, keeps the argument layout of the other kernels
+	bool horizontal
+)
+{
+	int x = get_global_id(0) * BLOCK;
+	int y = get_global_id(1);
+
+	// Global work size is rounded up to whole work-groups
+	if (x >= width || y >= height) return;
+	// The last block of a row may be partial
+	int count = min(BLOCK, width - x);
+	bool full = count == BLOCK;
+
+	ACCUMULATOR_TYPE color[BLOCK_SIZE];
+	#pragma unroll
+	for (int j = 0; j < BLOCK_SIZE; j++) color[j] = 0;
+#ifdef HALF8_BLOCK
+	half8 colors[BLOCK_VECTORS];
+	#pragma unroll
+	for (int v = 0; v < BLOCK_VECTORS; v++) colors[v] = 0;
+#endif
+
+	if (horizontal) {
+		__global const PIXEL_TYPE* row = A + (size_t)CHANNELS * y * width;
+		PIXEL_TYPE window[WINDOW_SIZE];
+		int windowX = x - RADIUS;
+		if (windowX >= 0 && windowX + BLOCK + 2 * RADIUS <= width) {
+			loadComponents(row + CHANNELS * windowX, window, WINDOW_SIZE);
+		} else {
+			// Only the windows reaching beyond the image pay for the border handling
+			for (int p = 0; p < BLOCK + 2 * RADIUS; p++) {
+				int sourceX = borderIndex(windowX + p, width);
+				#pragma unroll
+				for (int c = 0; c < CHANNELS; c++) {
+					window[CHANNELS * p + c] = BORDER == BORDER_CONSTANT && sourceX < 0 ? 0 : row[CHANNELS * sourceX + c];
+				}
+			}
+		}
+
+		// Slide the kernel over the window
+#ifdef SYMMETRIC
+		// Mirrored taps share their weight, add the pixel pair first and multiply once
+		#pragma unroll
+		for (int i = 0; i < RADIUS; i++) {
+			WEIGHT_TYPE kernelValue = SMOOTH_KERNEL_VALUE(i);
+			ACCUMULATE_TAP_PAIR(window + CHANNELS * i, window + CHANNELS * (2 * RADIUS - i), kernelValue);
+		}
+		WEIGHT_TYPE centerValue = SMOOTH_KERNEL_VALUE(RADIUS);
+		ACCUMULATE_TAP(window + CHANNELS * RADIUS, centerValue);
+#else
+		#pragma unroll
+		for (int i = 0; i < SMOOTH_KERNEL_DIMENSION; i++) {
+			WEIGHT_TYPE kernelValue = SMOOTH_KERNEL_VALUE(i);
+			ACCUMULATE_TAP(window + CHANNELS * i, kernelValue);
+		}
+#endif
+	} else {
+		// Load the block of a tap row, rows outside of the image are read according to the border mode
+		PIXEL_TYPE taps[BLOCK_SIZE];
+		#define LOAD_TAP_ROW(i, destination) { \
+			int sourceY = borderIndex(y + (i) - RADIUS, height); \
+			if (BORDER == BORDER_CONSTANT && sourceY < 0) { \
+				for (int j = 0; j < BLOCK_SIZE; j++) (destination)[j] = 0; \
+			} else { \
+				__global const PIXEL_TYPE* source = A + (size_t)CHANNELS * (sourceY * width + x); \
+				loadComponents(source, destination, full ? BLOCK_SIZE : CHANNELS * count); \
+			} \
+		}
+#ifdef SYMMETRIC
+		// Mirrored taps share their weight, add the pixel pair first and multiply once
+		PIXEL_TYPE mirroredTaps[BLOCK_SIZE];
+		#pragma unroll
+		for (int i = 0; i < RADIUS; i++) {
+			LOAD_TAP_ROW(i, taps);
+			LOAD_TAP_ROW(2 * RADIUS - i, mirroredTaps);
+			WEIGHT_TYPE kernelValue = SMOOTH_KERNEL_VALUE(i);
+			ACCUMULATE_TAP_PAIR(taps, mirroredTaps, kernelValue);
+		}
+		LOAD_TAP_ROW(RADIUS, taps);
+		WEIGHT_TYPE centerValue = SMOOTH_KERNEL_VALUE(RADIUS);
+		ACCUMULATE_TAP(taps, centerValue);
+#else
+		#pragma unroll
+		for (int i = 0; i < SMOOTH_KERNEL_DIMENSION; i++) {
+			LOAD_TAP_ROW(i, taps);
+			WEIGHT_TYPE kernelValue = SMOOTH_KERNEL_VALUE(i);
+			ACCUMULATE_TAP(taps, kernelValue);
+		}
+#endif
+		#undef LOAD_TAP_ROW
+	}
+#ifdef HALF8_BLOCK
+	#pragma unroll
+	for (int v = 0; v < BLOCK_VECTORS; v++) vstore8(colors[v], v, color);
+#endif
+
+	// Write results for each color component of the block
+	PIXEL_TYPE result[BLOCK_SIZE];
+	#pragma unroll
+	for (int j = 0; j < BLOCK_SIZE; j++) result[j] = SCALE_RESULT(color[j]);
+	size_t index = CHANNELS * ((size_t)y * width + x);
+#ifdef SHARPEN_AMOUNT
+	if (!horizontal) {
+		// The destination still holds the original pixels
+		loadComponents(B + index, result, full ? BLOCK_SIZE : CHANNELS * count);
+		#pragma unroll
+		for (int j = 0; j < BLOCK_SIZE; j++) result[j] = sharpenComponent(result[j], color[j]);
+	}
+#endif
+	storeComponents(result, B + index, full ? BLOCK_SIZE : CHANNELS * count);
+}
+DIRECTIONAL_KERNELS(gaussian_blur_blocked, gaussianBlurBlocked, __global const PIXEL_TYPE*, __global PIXEL_TYPE*, __local PIXEL_TYPE*)
+#endif
+
+#if CHANNELS == 1
+// 16 consecutive pixels of row y starting at x, pixels outside of the image are read according to the border mode
+inline ACCUMULATOR_TYPE16 loadGray16(__global const PIXEL_TYPE* A, int width, int height, int x, int y)
+{
+	int sourceY = borderIndex(y, height);
+#if BORDER == BORDER_CONSTANT
+	if (sourceY < 0) return 0;
+#endif
+	__global const PIXEL_TYPE* row = A + (size_t)sourceY * width;
+	if (x >= 0 && x + 16 <= width) return CONVERT_ACCUMULATOR16(vload16(0, row + x));
+
+	PIXEL_TYPE pixels[16];
+	#pragma unroll
+	for (int i = 0; i < 16; i++) {
+		int sourceX = borderIndex(x + i, width);
+		pixels[i] = BORDER == BORDER_CONSTANT && sourceX < 0 ? 0 : row[sourceX];
+	}
+	return CONVERT_ACCUMULATOR16(vload16(0, pixels));
+}
+
+// Grayscale images only, every work-item blurs 16 consecutive pixels of a row as one vector
+inline void gaussianBlurGray(
+	__global const PIXEL_TYPE *A,
+	__global PIXEL_TYPE *B,
+	int width,
+	int height,
+	__constant float *smoothKernel,
+	int smoothKernelDimension,
+	__local PIXEL_TYPE* tile, // unused, keeps the argument layout of the other kernels
+	bool horizontal
+)
+{
+	int x = get_global_id(0) * 16;
+	int y = get_global_id(1);
+
+	// Global work size is rounded up to whole work-groups
+	if (x >= width || y >= height) return;
+
+	// Apply gauss kernel, the taps are whole vectors shifted along the blur direction
+	int stepX = horizontal ? 1 : 0;
+	int stepY = horizontal ? 0 : 1;
+	#define TAP(i) loadGray16(A, width, height, x + stepX * ((i) - RADIUS), y + stepY * ((i) - RADIUS))
+	ACCUMULATOR_TYPE16 color = 0;
+#ifdef SYMMETRIC
+	// Mirrored taps share their weight, add the pixel pair first and multiply once
+	#pragma unroll
+	for (int i = 0; i < RADIUS; i++) color += (TAP(i) + TAP(2 * RADIUS - i)) * SMOOTH_KERNEL_VALUE(i);
+	color += TAP(RADIUS) * SMOOTH_KERNEL_VALUE(RADIUS);
+#else
+	#pragma unroll
+	for (int i = 0; i < SMOOTH_KERNEL_DIMENSION; i++) color += TAP(i) * SMOOTH_KERNEL_VALUE(i);
+#endif
+	#undef TAP
+
+	PIXEL_TYPE16 result = CONVERT_PIXEL16(SCALE_RESULT(color));
+	size_t index = (size_t)y * width + x;
+#ifdef SHARPEN_AMOUNT
+	if (!horizontal) {
+		// The destination still holds the original pixels
+		ACCUMULATOR_TYPE sums[16];
+		PIXEL_TYPE pixels[16];
+		vstore16(color, 0, sums);
+		#pragma unroll
+		for (int i = 0; i < 16; i++) pixels[i] = sharpenComponent(x + i < width ? B[index + i] : 0, sums[i]);
+		result = vload16(0, pixels);
+	}
+#endif
+	if (x + 16 <= width) {
+		vstore16(result, 0, B + index);
+	} else {
+		// The last block of a row is partial
+		PIXEL_TYPE pixels[16];
+		vstore16(result, 0, pixels);
+		for (int i = 0; i < width - x; i++) B[index + i] = pixels[i];
+	}
+}
+DIRECTIONAL_KERNELS(gaussian_blur_gray, gaussianBlurGray, __global const PIXEL_TYPE*, __global PIXEL_TYPE*, __local PIXEL_TYPE*)
+#endif
+
+#ifdef SUBGROUP
+// Needs cl_khr_subgroup_shuffle, neighbouring pixels are exchanged between the work-items of a sub-group.
+// The sub-group built-ins need cl_khr_subgroups, OpenCL 2.1 (-cl-std=CL2.0) or __opencl_c_subgroups (-cl-std=CL3.0)
+#pragma OPENCL EXTENSION cl_khr_subgroups : enable
+#pragma OPENCL EXTENSION cl_khr_subgroup_shuffle : enable
+
+// Pixel x of a row, outside of it according to the border mode
+inline void loadRowPixel(PIXEL_TYPE* destination, __global const PIXEL_TYPE* row, int x, int width)
+{
+	int k = borderIndex(x, width);
+	#pragma unroll
+	for (int c = 0; c < CHANNELS; c++) destination[c] = BORDER == BORDER_CONSTANT && k < 0 ? 0 : row[CHANNELS * k + c];
+}
+
+// Component c of the pixel d pixels right of the work-item at lane x of its sub-group. The sub-group holds its own
+// run of pixels in center and the runs left and right of it in left and right, one pixel per work-item each.
+// The branch is uniform across the sub-group, sub-groups narrower than the radius read far taps from global memory.
+inline PIXEL_TYPE shuffleTap(
+	const PIXEL_TYPE* left,
+	const PIXEL_TYPE* center,
+	const PIXEL_TYPE* right,
+	__global const PIXEL_TYPE* row,
+	int x,
+	int width,
+	int lane,
+	int size,
+	int d,
+	int c
+)
+{
+	if (d < -size || d > size) {
+		int k = borderIndex(x + d, width);
+		return BORDER == BORDER_CONSTANT && k < 0 ? 0 : row[CHANNELS * k + c];
+	}
+	int p = lane + d;
+	int source = p < 0 ? p + size : p >= size ? p - size : p;
+	PIXEL_TYPE inside = sub_group_shuffle(center[c], source);
+	PIXEL_TYPE outside = sub_group_shuffle(d < 0 ? left[c] : right[c], source);
+	return p >= 0 && p < size ? inside : outside;
+}
+
+// Horizontal pass only, work-groups are runs of a single row. Every work-item loads its own pixel and the pixels
+// one sub-group width to either side into registers, the taps are read from the registers of the other work-items
+// of the sub-group, so neither local memory nor barriers are needed.
+__kernel void gaussian_blur_subgroup(
+	__global const PIXEL_TYPE *A,
+	__global PIXEL_TYPE *B,
+	int width,
+	int height,
+	__constant float *smoothKernel,
+	int smoothKernelDimension,
+	__local PIXEL_TYPE* tile // unused, keeps the argument layout of the other kernels
+)
+{
+#ifdef BATCH
+	A = BATCH_IMAGE(A);
+	B = BATCH_IMAGE(B);
+#endif
+	int x = get_global_id(0);
+	int y = get_global_id(1);
+	int lane = get_sub_group_local_id();
+	int size = get_sub_group_size();
+	__global const PIXEL_TYPE* row = A + (size_t)CHANNELS * y * width;
+
+	// Work-items beyond the image still take part in the shuffles, they only skip the store
+	PIXEL_TYPE left[CHANNELS], center[CHANNELS], right[CHANNELS];
+	int start = x - lane;
+	if (start - size >= 0 && start + 2 * size <= width) {
+		#pragma unroll
+		for (int c = 0; c < CHANNELS; c++) {
+			left[c] = row[CHANNELS * (x - size) + c];
+			center[c] = row[CHANNELS * x + c];
+			right[c] = row[CHANNELS * (x + size) + c];
+		}
+	} else {
+		loadRowPixel(left, row, x - size, width);
+		loadRowPixel(center, row, x, width);
+		loadRowPixel(right, row, x + size, width);
+	}
+
+	ACCUMULATOR_TYPE color[CHANNELS];
+	#pragma unroll
+	for (int c = 0; c < CHANNELS; c++) color[c] = 0;
+	#define SHUFFLE_TAP(d, c) shuffleTap(left, center, right, row, x, width, lane, size, d, c)
+#ifdef SYMMETRIC
+	// Mirrored taps share their weight, add the pixel pair first and multiply once
+	#pragma unroll
+	for (int i = 0; i < RADIUS; i++) {
+		int offset = RADIUS - i;
+		WEIGHT_TYPE kernelValue = SMOOTH_KERNEL_VALUE(i);
+		#pragma unroll
+		for (int c = 0; c < CHANNELS; c++) color[c] += (SHUFFLE_TAP(-offset, c) + SHUFFLE_TAP(offset, c)) * kernelValue;
+	}
+	WEIGHT_TYPE centerValue = SMOOTH_KERNEL_VALUE(RADIUS);
+	#pragma unroll
+	for (int c = 0; c < CHANNELS; c++) color[c] += center[c] * centerValue;
+#else
+	#pragma unroll
+	for (int i = 0; i < SMOOTH_KERNEL_DIMENSION; i++) {
+		WEIGHT_TYPE kernelValue = SMOOTH_KERNEL_VALUE(i);
+		#pragma unroll
+		for (int c = 0; c < CHANNELS; c++) color[c] += SHUFFLE_TAP(i - RADIUS, c) * kernelValue;
+	}
+#endif
+	#undef SHUFFLE_TAP
+
+	if (x >= width) return;
+	STORE_PIXEL(__global, B + CHANNELS * ((size_t)y * width + x), color);
+}
+#endif
+
+#ifdef RECURSIVE
+// The recursive kernel is only built with -DRECURSIVE, it always filters in float
+#if defined(FIXED_POINT) || defined(HALF_PRECISION)
+#error "The recursive kernel needs float precision"
+#endif
+
+// Coefficients of the van Vliet, Young & Verbeek filter split into first order sections: real pole, complex pole,
+// real residue, complex residue, real and complex steady state gain and the 3x3 border matrix of the anti-causal
+// scan. Specialized variants are built with -DRECURSIVE_COEFFICIENTS=<coefficients>,
+// otherwise they are passed as the smooth kernel
+#ifdef RECURSIVE_COEFFICIENTS
+__constant float specializedRecursiveCoefficients[18] = {RECURSIVE_COEFFICIENTS};
+#define RECURSIVE_COEFFICIENT(i) specializedRecursiveCoefficients[i]
+#else
+#define RECURSIVE_COEFFICIENT(i) smoothKernel[i]
+#endif
+#define BORDER_COEFFICIENT(i, j) RECURSIVE_COEFFICIENT(9 + 3 * (i) + (j))
+
+// Recursive Gaussian (van Vliet, Young & Verbeek), every work-item filters a whole row or column with a causal scan
+// followed by an anti-causal scan, so the cost per pixel is independent of sigma.
+// Both scans run the real section and the complex section, whose conjugate only doubles its real part.
+// Neighbouring work-items read neighbouring pixels in the vertical pass only.
+inline void gaussianBlurRecursive(
+	__global const PIXEL_TYPE *A,
+	__global PIXEL_TYPE *B,
+	int width,
+	int height,
+	__constant float *smoothKernel,
+	int smoothKernelDimension,
+	__global float* scratch, // causal results in float, the size of the image
+	bool horizontal
+)
+{
+	int line = get_global_id(0);
+
+	// Global work size is rounded up to whole work-groups
+	if (line >= (horizontal ? height : width)) return;
+	int length = horizontal ? width : height;
+	size_t start = CHANNELS * (horizontal ? (size_t)line * width : (size_t)line);
+	size_t step = CHANNELS * (horizontal ? 1 : (size_t)width);
+
+	float pole = RECURSIVE_COEFFICIENT(0);
+	float complexPoleRe = RECURSIVE_COEFFICIENT(1);
+	float complexPoleIm = RECURSIVE_COEFFICIENT(2);
+	float residue = RECURSIVE_COEFFICIENT(3);
+	float complexResidueRe = RECURSIVE_COEFFICIENT(4);
+	float complexResidueIm = RECURSIVE_COEFFICIENT(5);
+	float gain = RECURSIVE_COEFFICIENT(6);
+	float complexGainRe = RECURSIVE_COEFFICIENT(7);
+	float complexGainIm = RECURSIVE_COEFFICIENT(8);
+
+	// Section states per component
+	float real[CHANNELS], complexRe[CHANNELS], complexIm[CHANNELS];
+	#define RECURSIVE_STEP(c, input, result) { \
+		float nextRe = complexResidueRe * (input) + complexPoleRe * complexRe[c] - complexPoleIm * complexIm[c]; \
+		complexIm[c] = complexResidueIm * (input) + complexPoleRe * complexIm[c] + complexPoleIm * complexRe[c]; \
+		complexRe[c] = nextRe; \
+		real[c] = residue * (input) + pole * real[c]; \
+		result = real[c] + 2 * complexRe[c]; \
+	}
+
+	// Border handling, the scan starts in the steady state of the nearest valid pixel
+	#pragma unroll
+	for (int c = 0; c < CHANNELS; c++) {
+		float border = A[start + c];
+		real[c] = gain * border;
+		complexRe[c] = complexGainRe * border;
+		complexIm[c] = complexGainIm * border;
+	}
+	for (int i = 0; i < length; i++) {
+		size_t index = start + i * step;
+		#pragma unroll
+		for (int c = 0; c < CHANNELS; c++) RECURSIVE_STEP(c, A[index + c], scratch[index + c]);
+	}
+
+	// Border handling, the anti-causal scan starts where it would be after a border of the last pixel,
+	// given by the deviations of the causal states from the steady state of it
+	size_t last = start + (length - 1) * step;
+	#pragma unroll
+	for (int c = 0; c < CHANNELS; c++) {
+		float border = A[last + c];
+		float deviationReal = real[c] - gain * border;
+		float deviationRe = complexRe[c] - complexGainRe * border;
+		float deviationIm = complexIm[c] - complexGainIm * border;
+		real[c] = gain * border + BORDER_COEFFICIENT(0, 0) * deviationReal +
+			BORDER_COEFFICIENT(0, 1) * deviationRe + BORDER_COEFFICIENT(0, 2) * deviationIm;
+		complexRe[c] = complexGainRe * border + BORDER_COEFFICIENT(1, 0) * deviationReal +
+			BORDER_COEFFICIENT(1, 1) * deviationRe + BORDER_COEFFICIENT(1, 2) * deviationIm;
+		complexIm[c] = complexGainIm * border + BORDER_COEFFICIENT(2, 0) * deviationReal +
+			BORDER_COEFFICIENT(2, 1) * deviationRe + BORDER_COEFFICIENT(2, 2) * deviationIm;
+	}
+	for (int i = length - 1; i >= 0; i--) {
+		size_t index = start + i * step;
+		float color[CHANNELS];
+		#pragma unroll
+		for (int c = 0; c < CHANNELS; c++) RECURSIVE_STEP(c, scratch[index + c], color[c]);
+		STORE_PIXEL(__global, B + index, color);
+	}
+	#undef RECURSIVE_STEP
+}
+DIRECTIONAL_KERNELS(gaussian_blur_recursive, gaussianBlurRecursive, __global const PIXEL_TYPE*, __global PIXEL_TYPE*, __global float*)
+#endif
+
+#ifdef BOX
+// The box kernel is only built with -DBOX, it always filters in float
+#if defined(FIXED_POINT) || defined(HALF_PRECISION)
+#error "The box kernel needs float precision"
+#endif
+
+// Radii of the three boxes, specialized variants are built with -DBOX_RADII=<radii>,
+// otherwise they are passed as the smooth kernel
+#ifdef BOX_RADII
+__constant int specializedBoxRadii[3] = {BOX_RADII};
+#define BOX_RADIUS(i) specializedBoxRadii[i]
+#else
+#define BOX_RADIUS(i) ((int)smoothKernel[i])
+#endif
+
+// Mean of the 2 * radius + 1 pixels around every pixel of the line as a running sum, every step adds the pixel
+// entering the window and subtracts the one leaving it. Border handling, use nearest valid pixel
+#define BOX_FILTER(source, destination, radius, STORE) { \
+	int r = (radius); \
+	float scale = 1.0f / (2 * r + 1); \
+	float sum[CHANNELS]; \
+	for (int c = 0; c < CHANNELS; c++) sum[c] = (r + 1) * (float)(source)[start + c]; \
+	for (int k = 1; k <= r; k++) { \
+		size_t entering = start + min(k, length - 1) * step; \
+		for (int c = 0; c < CHANNELS; c++) sum[c] += (source)[entering + c]; \
+	} \
+	for (int i = 0; i < length; i++) { \
+		size_t index = start + i * step; \
+		float color[CHANNELS]; \
+		for (int c = 0; c < CHANNELS; c++) color[c] = sum[c] * scale; \
+		STORE((destination) + index, color); \
+		size_t entering = start + min(i + r + 1, length - 1) * step; \
+		size_t leaving = start + max(i - r, 0) * step; \
+		for (int c = 0; c < CHANNELS; c++) sum[c] += (float)(source)[entering + c] - (float)(source)[leaving + c]; \
+	} \
+}
+#define STORE_FLOAT(destination, color) for (int c = 0; c < CHANNELS; c++) (destination)[c] = (color)[c]
+#define STORE_OUTPUT(destination, color) STORE_PIXEL(__global, destination, color)
+
+// Three box filters in a row approximate a Gaussian, every work-item filters a whole row or column,
+// so the cost per pixel is independent of the box widths.
+// Neighbouring work-items read neighbouring pixels in the vertical pass only.
+inline void gaussianBlurBox(
+	__global const PIXEL_TYPE *A,
+	__global PIXEL_TYPE *B,
+	int width,
+	int height,
+	__constant float *smoothKernel,
+	int smoothKernelDimension,
+	__global float* scratch, // results of the first two boxes in float, twice the size of the image
+	bool horizontal
+)
+{
+	int line = get_global_id(0);
+
+	// Global work size is rounded up to whole work-groups
+	if (line >= (horizontal ? height : width)) return;
+	int length = horizontal ? width : height;
+	size_t start = CHANNELS * (horizontal ? (size_t)line * width : (size_t)line);
+	size_t step = CHANNELS * (horizontal ? 1 : (size_t)width);
+	__global float* first = scratch;
+	__global float* second = scratch + (size_t)CHANNELS * width * height;
+
+	BOX_FILTER(A, first, BOX_RADIUS(0), STORE_FLOAT);
+	BOX_FILTER(first, second, BOX_RADIUS(1), STORE_FLOAT);
+	BOX_FILTER(second, B, BOX_RADIUS(2), STORE_OUTPUT);
+}
+DIRECTIONAL_KERNELS(gaussian_blur_box, gaussianBlurBox, __global const PIXEL_TYPE*, __global PIXEL_TYPE*, __global float*)
+#endif
+
+#ifdef PYRAMID
+// The pyramid kernels are only built with -DPYRAMID=<levels>. Every level is a float image of half the size
+// of the level before (rounded up), whose pixel centers lie between the pixel pairs of the level before
+
+// Anti-alias filter of the downsampling, the binomial (1 3 3 1) / 8 centered between two pixels
+__constant float binomialKernel[4] = {0.125f, 0.375f, 0.375f, 0.125f};
+
+// Halves the image, every work-item filters the 4x4 source pixels around one destination pixel
+__kernel void gaussian_blur_downsample(
+	__global const PIXEL_TYPE *A,
+	__global float *B,
+	int width, // of the source level
+	int height,
+	__constant float *smoothKernel,
+	int smoothKernelDimension,
+	__local PIXEL_TYPE* tile // unused, keeps the argument layout of the other kernels
+)
+{
+	int x = get_global_id(0);
+	int y = get_global_id(1);
+	int levelWidth = (width + 1) / 2;
+	int levelHeight = (height + 1) / 2;
+
+	// Global work size is rounded up to whole work-groups
+	if (x >= levelWidth || y >= levelHeight) return;
+
+	float color[CHANNELS];
+	#pragma unroll
+	for (int c = 0; c < CHANNELS; c++) color[c] = 0;
+	#pragma unroll
+	for (int j = 0; j < 4; j++) {
 		// Border handling, use nearest valid pixel
-		k = clamp(k, 0, (int)localMax);
+		int sourceY = clamp(2 * y - 1 + j, 0, height - 1);
+		#pragma unroll
+		for (int i = 0; i < 4; i++) {
+			int sourceX = clamp(2 * x - 1 + i, 0, width - 1);
+			size_t sourceIndex = CHANNELS * ((size_t)sourceY * width + sourceX);
+			float weight = binomialKernel[i] * binomialKernel[j];
+			#pragma unroll
+			for (int c = 0; c < CHANNELS; c++) color[c] += A[sourceIndex + c] * weight;
+		}
+	}
+
+	size_t index = CHANNELS * ((size_t)y * levelWidth + x);
+	#pragma unroll
+	for (int c = 0; c < CHANNELS; c++) B[index + c] = color[c];
+}
+
+// Interpolates the coarsest level bilinearly back to the full resolution
+__kernel void gaussian_blur_upsample(
+	__global const float *A,
+	__global PIXEL_TYPE *B,
+	int width, // of the full resolution
+	int height,
+	__constant float *smoothKernel,
+	int smoothKernelDimension,
+	__local PIXEL_TYPE* tile // unused, keeps the argument layout of the other kernels
+)
+{
+	int x = get_global_id(0);
+	int y = get_global_id(1);
 
-		size_t kIndex = channels * k;
-		float kernelValue = smoothKernel[i];
-		red += pixel[kIndex] * kernelValue;
-		green += pixel[kIndex + 1] * kernelValue;
-		blue += pixel[kIndex + 2] * kernelValue;
+	// Global work size is rounded up to whole work-groups
+	if (x >= width || y >= height) return;
+
+	int levelWidth = (width + (1 << PYRAMID) - 1) >> PYRAMID;
+	int levelHeight = (height + (1 << PYRAMID) - 1) >> PYRAMID;
+	float levelX = (x + 0.5f) / (1 << PYRAMID) - 0.5f;
+	float levelY = (y + 0.5f) / (1 << PYRAMID) - 0.5f;
+	int left = (int)floor(levelX);
+	int top = (int)floor(levelY);
+	float fractionX = levelX - left;
+	float fractionY = levelY - top;
+
+	// Border handling, use nearest valid pixel
+	size_t topRow = CHANNELS * (size_t)clamp(top, 0, levelHeight - 1) * levelWidth;
+	size_t bottomRow = CHANNELS * (size_t)clamp(top + 1, 0, levelHeight - 1) * levelWidth;
+	size_t leftColumn = CHANNELS * clamp(left, 0, levelWidth - 1);
+	size_t rightColumn = CHANNELS * clamp(left + 1, 0, levelWidth - 1);
+
+	float color[CHANNELS];
+	#pragma unroll
+	for (int c = 0; c < CHANNELS; c++) {
+		float upper = mix(A[topRow + leftColumn + c], A[topRow + rightColumn + c], fractionX);
+		float lower = mix(A[bottomRow + leftColumn + c], A[bottomRow + rightColumn + c], fractionX);
+		color[c] = mix(upper, lower, fractionY);
 	}
 
-	// Write results for each color component
-	// Three consecutive color components represent one pixel
-	B[index] = red;
-	B[index + 1] = green;
-	B[index + 2] = blue;
+	size_t index = CHANNELS * ((size_t)y * width + x);
+	STORE_PIXEL(__global, B + index, color);
+}
+#endif
+
+#ifdef IMAGE
+// The image kernel is only built with -DIMAGE. Pixels are read through the texture path of the device as
+// normalized float4, whatever channel count & component type the image objects have. The sampler handles
+// the border mode for reads outside of the image, writes are converted back to the format of the destination.
+#if BORDER == BORDER_MIRROR || BORDER == BORDER_WRAP
+// Repeating address modes need normalized coordinates, taps read the centers of the pixels
+#if BORDER == BORDER_MIRROR
+__constant sampler_t borderSampler = CLK_NORMALIZED_COORDS_TRUE | CLK_ADDRESS_MIRRORED_REPEAT | CLK_FILTER_NEAREST;
+#else
+__constant sampler_t borderSampler = CLK_NORMALIZED_COORDS_TRUE | CLK_ADDRESS_REPEAT | CLK_FILTER_NEAREST;
+#endif
+#define READ_TAP(image, coordinate) \
+	read_imagef(image, borderSampler, (convert_float2(coordinate) + 0.5f) / (float2)(width, height))
+#else
+#if BORDER == BORDER_CONSTANT
+__constant sampler_t borderSampler = CLK_NORMALIZED_COORDS_FALSE | CLK_ADDRESS_CLAMP | CLK_FILTER_NEAREST;
+#else
+__constant sampler_t borderSampler = CLK_NORMALIZED_COORDS_FALSE | CLK_ADDRESS_CLAMP_TO_EDGE | CLK_FILTER_NEAREST;
+#endif
+#define READ_TAP(image, coordinate) read_imagef(image, borderSampler, coordinate)
+#endif
+
+inline void gaussianBlurImage(
+	__read_only image2d_t A,
+	__write_only image2d_t B,
+	int width,
+	int height,
+	__constant float *smoothKernel,
+	int smoothKernelDimension,
+	__local PIXEL_TYPE* pixel, // unused, keeps the argument layout of the other kernels
+	bool horizontal
+)
+{
+	int x = get_global_id(0);
+	int y = get_global_id(1);
+
+	// Global work size is rounded up to whole work-groups
+	if (x >= width || y >= height) return;
+
+	int2 center = (int2)(x, y);
+	int2 step = horizontal ? (int2)(1, 0) : (int2)(0, 1);
+	float4 color = (float4)(0.0f, 0.0f, 0.0f, 0.0f);
+#ifdef SYMMETRIC
+	// Mirrored taps share their weight, add the pixel pair first and multiply once
+	#pragma unroll
+	for (int i = 0; i < RADIUS; i++) {
+		int2 offset = (RADIUS - i) * step;
+		color += (READ_TAP(A, center - offset) + READ_TAP(A, center + offset)) * SMOOTH_KERNEL_VALUE(i);
+	}
+	color += READ_TAP(A, center) * SMOOTH_KERNEL_VALUE(RADIUS);
+#else
+	#pragma unroll
+	for (int i = 0; i < SMOOTH_KERNEL_DIMENSION; i++) {
+		color += READ_TAP(A, center + (i - RADIUS) * step) * SMOOTH_KERNEL_VALUE(i);
+	}
+#endif
+
+	write_imagef(B, center, color);
 }
+DIRECTIONAL_KERNELS(gaussian_blur_image, gaussianBlurImage, __read_only image2d_t, __write_only image2d_t, __local PIXEL_TYPE*)
+#endif